@@ -23,22 +23,16 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 
+include(core.pri)
+
 SOURCES += main.cpp\
         window_main.cpp \
     dialog_settings.cpp \
-    memory_settings.cpp \
-    command_processor.cpp \
-    memory.cpp \
-    block.cpp \
-    memory_info.cpp
+    commands_model.cpp
 
 HEADERS  += window_main.h \
     dialog_settings.h \
-    memory_settings.h \
-    command_processor.h \
-    memory.h \
-    block.h \
-    memory_info.h
+    commands_model.h
 
 FORMS    += window_main.ui \
     dialog_settings.ui
@@ -0,0 +1,174 @@
+#include "backing_store.h"
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include <QFile>
+
+#include "memory_settings.h"
+
+const uint8_t BackingStore::HUGE_PAGE_DEGREE;
+
+BackingStore::BackingStore() :
+	base(nullptr),
+	size(0),
+	mappedBase(nullptr),
+	mappedSize(0),
+	pageMode(PageMode::Regular)
+{
+
+}
+
+BackingStore::~BackingStore()
+{
+	release();
+}
+
+QResultStatus BackingStore::reserve(const uint8_t degree, const PageMode mode)
+{
+	release();
+	uint64_t bytes = MemorySettings::degreeToBytes(degree);
+	// regions smaller than a huge page are never backed by one
+	bool isHuge = (mode != PageMode::Regular && degree >= HUGE_PAGE_DEGREE);
+#ifdef Q_OS_WIN
+	Q_UNUSED(isHuge);
+	void* region = VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (region == nullptr)
+	{
+		return QResult_Failure;
+	}
+	mappedBase = region;
+	mappedSize = bytes;
+	base = static_cast<uint8_t*>(region);
+#else
+#ifdef MAP_HUGETLB
+	if (isHuge && mode == PageMode::ExplicitHuge)
+	{
+		void* region = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (region != MAP_FAILED)
+		{
+			mappedBase = region;
+			mappedSize = bytes;
+			base = static_cast<uint8_t*>(region);
+			size = bytes;
+			pageMode = PageMode::ExplicitHuge;
+			return QResult_Success;
+		}
+	}
+#endif
+	// no swap is reserved, untouched pages cost nothing
+	uint64_t alignment = (isHuge ? MemorySettings::degreeToBytes(HUGE_PAGE_DEGREE) : 0);
+	void* region = mmap(nullptr, bytes + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (region == MAP_FAILED)
+	{
+		return QResult_Failure;
+	}
+	mappedBase = region;
+	mappedSize = bytes + alignment;
+	// huge pages of the region must match those of the addresses of memory
+	quintptr address = reinterpret_cast<quintptr>(region);
+	base = reinterpret_cast<uint8_t*>(isHuge ? (address + alignment - 1) & ~quintptr(alignment - 1) : address);
+#ifdef MADV_HUGEPAGE
+	if (isHuge && madvise(base, bytes, MADV_HUGEPAGE) == 0)
+	{
+		pageMode = PageMode::TransparentHuge;
+	}
+#endif
+#endif
+	size = bytes;
+	return QResult_Success;
+}
+
+void BackingStore::release()
+{
+	if (mappedBase == nullptr)
+	{
+		return;
+	}
+#ifdef Q_OS_WIN
+	VirtualFree(mappedBase, 0, MEM_RELEASE);
+#else
+	munmap(mappedBase, mappedSize);
+#endif
+	base = nullptr;
+	size = 0;
+	mappedBase = nullptr;
+	mappedSize = 0;
+	pageMode = PageMode::Regular;
+}
+
+bool BackingStore::isReserved() const
+{
+	return base != nullptr;
+}
+
+uint64_t BackingStore::getSize() const
+{
+	return size;
+}
+
+PageMode BackingStore::getPageMode() const
+{
+	return pageMode;
+}
+
+uint64_t BackingStore::getHugePageBytes() const
+{
+	if (pageMode == PageMode::ExplicitHuge)
+	{
+		return size;
+	}
+	uint64_t hugeBytes = 0;
+#ifdef Q_OS_LINUX
+	if (pageMode != PageMode::TransparentHuge)
+	{
+		return 0;
+	}
+	QFile file("/proc/self/smaps");
+	if (!file.open(QFile::ReadOnly)) {
+		return 0;
+	}
+	// mappings are headed by their address range, AnonHugePages of those within the region are summed
+	quintptr begin = reinterpret_cast<quintptr>(base);
+	bool isInRegion = false;
+	foreach (const QByteArray& line, file.readAll().split('\n'))
+	{
+		int separator = line.indexOf('-');
+		int space = line.indexOf(' ');
+		bool isBeginParsed = false;
+		bool isEndParsed = false;
+		quintptr mappingBegin = (separator > 0 && separator < space ? line.left(separator).toULongLong(&isBeginParsed, 16) : 0);
+		quintptr mappingEnd = (isBeginParsed ? line.mid(separator + 1, space - separator - 1).toULongLong(&isEndParsed, 16) : 0);
+		if (isEndParsed)
+		{
+			isInRegion = mappingBegin < begin + size && mappingEnd > begin;
+		}
+		else if (isInRegion && line.startsWith("AnonHugePages:"))
+		{
+			hugeBytes += line.mid(14).trimmed().split(' ').first().toULongLong() << 10;
+		}
+	}
+#endif
+	return hugeBytes;
+}
+
+uint8_t* BackingStore::toPointer(const uint64_t address) const
+{
+	return address < size ? base + address : nullptr;
+}
+
+QString BackingStore::pageModeToString(const PageMode mode)
+{
+	switch (mode)
+	{
+		case PageMode::TransparentHuge:
+			return "advised transparent huge pages";
+		case PageMode::ExplicitHuge:
+			return "explicit huge pages";
+		default:
+			return "regular pages";
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef BACKING_STORE_H
+#define BACKING_STORE_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+
+#include "common.h"
+
+/// Pages which back the region, one TLB entry of a huge page covers 2 MiB.
+enum class PageMode
+{
+	Regular,
+	/// Huge pages requested with madvise, the kernel backs what it can with them on touch.
+	TransparentHuge,
+	/// Huge pages reserved by the administrator, mapped with MAP_HUGETLB.
+	ExplicitHuge
+};
+
+/// Region of real memory behind the addresses of Memory, so placement can be measured on caches and the TLB.
+/// The region is reserved without being committed, the system backs its pages on the first touch.
+class BackingStore
+{
+	public:
+		static const uint8_t HUGE_PAGE_DEGREE = 21;
+
+		BackingStore();
+		~BackingStore();
+
+		/// Maps a region of 2^degree bytes, a region mapped before is released.
+		/// Huge pages which cannot be had fall back to transparent ones and then to regular pages.
+		QResultStatus reserve(const uint8_t degree, const PageMode mode = PageMode::Regular);
+		void release();
+		bool isReserved() const;
+		uint64_t getSize() const;
+		/// Pages the system accepted for the region, which may be smaller than the requested ones.
+		/// Transparent huge pages are only a hint, getHugePageBytes() tells how much of the region they back.
+		PageMode getPageMode() const;
+		/// Bytes of the region backed by huge pages at the moment, read from /proc/self/smaps for transparent ones.
+		uint64_t getHugePageBytes() const;
+		/// Pointer to the byte at the address of the simulated memory, nullptr when it is out of the region.
+		uint8_t* toPointer(const uint64_t address) const;
+		static QString pageModeToString(const PageMode mode);
+
+	private:
+		uint8_t* base;
+		uint64_t size;
+		/// Mapping as returned by the system, larger than the region when the region is aligned to a huge page.
+		void* mappedBase;
+		uint64_t mappedSize;
+		PageMode pageMode;
+
+		BackingStore(const BackingStore&);
+		BackingStore& operator=(const BackingStore&);
+};
+
+#endif // BACKING_STORE_H
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Headless benchmark of the buddy memory simulator
+#
+#-------------------------------------------------
+
+QT       += core gui charts
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = CP_SSW_benchmark
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+HEADERS += perf_counters.h
+SOURCES += main.cpp \
+    perf_counters.cpp
@@ -0,0 +1,619 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#include "command_processor.h"
+#include "workload_generator.h"
+#include "zone_allocator.h"
+#include "fixed_memory.h"
+#include "trace.h"
+#include "perf_counters.h"
+
+/// Fields of the pointer-based Block which preceded the node pool, kept to report the difference.
+struct PointerBlockLayout
+{
+	uint8_t sizeDegree;
+	uint8_t minDegree;
+	QString procName;
+	void* parent;
+	void* childFirst;
+	void* childSecond;
+	QColor color;
+	uint64_t beginAddress;
+};
+
+static QResultStatus loadCmds(const QString& path, CommandProcessor* processor)
+{
+	QFile file(path);
+	if (!file.open(QFile::ReadOnly | QFile::Text)) {
+		return QResult_NotFound;
+	}
+
+	QTextStream stream(&file);
+	QVector<Command*> cmds;
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine();
+		Command* cmd = new Command();
+		if (cmd->strToCmd(line) != QResult_Success)
+		{
+			delete cmd;
+			continue;
+		}
+		cmds.push_back(cmd);
+	}
+	processor->addCmds(cmds);
+	return processor->getCmdsCount() != 0 ? QResult_Success : QResult_IncorrectData;
+}
+
+static const char* POLICY_NAMES[] = { "first", "lowest", "highest", "best", "recent" };
+static const uint8_t POLICIES_COUNT = 5;
+static const char* ACTION_NAMES[] = { "allocate", "free", "query", "cache allocate", "cache free" };
+
+/// Results of one pass over the trace.
+struct ReplayResult
+{
+	uint32_t failedCount;
+	uint32_t peakNodes;
+	uint64_t splitsCount;
+	uint64_t mergesCount;
+	qint64 elapsed;
+	/// Time spent in the memory of blocks, a part of elapsed.
+	qint64 touchElapsed;
+	uint64_t touchedBytes;
+	uint64_t checksum;
+	/// Pages the backing got for the touches.
+	PageMode pageMode;
+	/// Touched memory which ended up on huge pages.
+	uint64_t hugePageBytes;
+	HugePageUsage hugePages;
+	MemoryAnalytics::Step lastStep;
+};
+
+/// Writes a byte at every stride of the block, or reads them back and sums them.
+static uint64_t touch(uint8_t* begin, const uint64_t bytes, const uint32_t stride, const bool isWrite)
+{
+	uint64_t sum = 0;
+	for (uint64_t offset = 0; offset < bytes; offset += stride)
+	{
+		if (isWrite) begin[offset] = uint8_t(offset >> 6);
+		else sum += begin[offset];
+	}
+	return sum;
+}
+
+/// Replays the trace, with a non-zero stride blocks are written when granted and read before they are freed.
+static void replay(CommandProcessor* processor, ReplayResult* replayResult, uint32_t touchStride = 0,
+				   const PageMode pageMode = PageMode::Regular)
+{
+	// replaying every command once, failed ones are skipped
+	uint32_t cmdsCount = processor->getCmdsCount();
+	Memory* mem = processor->getMemory();
+	replayResult->failedCount = 0;
+	replayResult->peakNodes = 0;
+	replayResult->touchElapsed = 0;
+	replayResult->touchedBytes = 0;
+	replayResult->checksum = 0;
+	replayResult->hugePageBytes = 0;
+	// a fresh mapping, so every policy pays for its own page faults
+	mem->setBackingEnabled(false);
+	if (touchStride != 0 && mem->setBackingEnabled(true, pageMode) != QResult_Success)
+	{
+		touchStride = 0;
+	}
+	replayResult->pageMode = mem->getBackingPageMode();
+	QHash<uint32_t, uint64_t> touchedSizes;
+	QString result;
+	QElapsedTimer timer;
+	QElapsedTimer touchTimer;
+	timer.start();
+	for (uint32_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
+	{
+		const Command* cmd = processor->getCmd(processor->getNextCmdIndex());
+		if (touchStride != 0 && cmd->action == CommandAction::Free && touchedSizes.contains(cmd->blockId))
+		{
+			touchTimer.start();
+			replayResult->checksum += touch(mem->getPointer(cmd->blockId), touchedSizes.take(cmd->blockId), touchStride, false);
+			replayResult->touchElapsed += touchTimer.nsecsElapsed();
+		}
+
+		result.clear();
+		if (processor->execNextCmd(&result) != QResult_Success)
+		{
+			++replayResult->failedCount;
+			processor->skipNextCmd();
+		}
+		else if (touchStride != 0 && cmd->action == CommandAction::Allocate)
+		{
+			touchTimer.start();
+			touch(mem->getPointer(cmd->blockId), cmd->blockSize, touchStride, true);
+			replayResult->touchElapsed += touchTimer.nsecsElapsed();
+			replayResult->touchedBytes += cmd->blockSize;
+			touchedSizes.insert(cmd->blockId, cmd->blockSize);
+		}
+		replayResult->peakNodes = qMax(replayResult->peakNodes, processor->getMemory()->getNodesCount());
+	}
+	replayResult->elapsed = timer.nsecsElapsed();
+	// transparent huge pages are a hint, what the kernel gave is seen only now
+	replayResult->hugePageBytes = mem->getBackingHugePageBytes();
+	mem->setBackingEnabled(false);
+	replayResult->hugePages = mem->getHugePageUsage();
+
+	replayResult->splitsCount = mem->getSplitsCount();
+	replayResult->mergesCount = mem->getMergesCount();
+	replayResult->lastStep.liveRequestedBytes = mem->getRequestedBytes();
+	replayResult->lastStep.liveGrantedBytes = mem->getGrantedBytes();
+	replayResult->lastStep.freeBytes = mem->getFreeBytes();
+	replayResult->lastStep.largestFreeDegree = mem->getLargestFreeDegree();
+}
+
+/// Replays allocations and frees of the trace through the fixed configuration, slab commands are skipped.
+template <uint8_t TotalDegree, uint8_t MinDegree>
+static void replayFixed(CommandProcessor* processor, ReplayResult* replayResult)
+{
+	// the tree of the fixed memory is too large for the stack
+	FixedMemory<TotalDegree, MinDegree>* mem = new FixedMemory<TotalDegree, MinDegree>();
+	uint32_t cmdsCount = processor->getCmdsCount();
+	replayResult->failedCount = 0;
+	QElapsedTimer timer;
+	timer.start();
+	for (uint32_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
+	{
+		const Command* cmd = processor->getCmd(cmdIndex);
+		QResultStatus status = QResult_Success;
+		if (cmd->action == CommandAction::Allocate) status = mem->allocate(cmd->blockSize, cmd->blockId);
+		else if (cmd->action == CommandAction::Free) status = mem->free(cmd->blockId);
+		if (status != QResult_Success) ++replayResult->failedCount;
+	}
+	replayResult->elapsed = timer.nsecsElapsed();
+	delete mem;
+}
+
+/// Allocations and frees of the trace straight through Memory, slab and query commands are skipped.
+/// The whole counters run over the pass, those of an action only around its calls.
+static void replayCounted(CommandProcessor* processor, PerfCounters* wholeCounters, PerfCounters* actionCounters,
+						  uint32_t* opsCounts)
+{
+	processor->resetExec();
+	Memory* mem = processor->getMemory();
+	uint32_t cmdsCount = processor->getCmdsCount();
+	wholeCounters->reset();
+	wholeCounters->enable();
+	for (uint32_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
+	{
+		const Command* cmd = processor->getCmd(cmdIndex);
+		if (cmd->action == CommandAction::Allocate) mem->allocate(cmd->blockSize, cmd->blockId, cmd->blockDegree);
+		else if (cmd->action == CommandAction::Free) mem->free(cmd->blockId);
+	}
+	wholeCounters->disable();
+
+	// toggling the counters costs system calls, so the actions are counted in a pass of their own
+	processor->resetExec();
+	opsCounts[CommandAction::Allocate] = 0;
+	opsCounts[CommandAction::Free] = 0;
+	actionCounters[CommandAction::Allocate].reset();
+	actionCounters[CommandAction::Free].reset();
+	for (uint32_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
+	{
+		const Command* cmd = processor->getCmd(cmdIndex);
+		if (cmd->action != CommandAction::Allocate && cmd->action != CommandAction::Free) continue;
+
+		PerfCounters& counters = actionCounters[cmd->action];
+		counters.enable();
+		if (cmd->action == CommandAction::Allocate) mem->allocate(cmd->blockSize, cmd->blockId, cmd->blockDegree);
+		else mem->free(cmd->blockId);
+		counters.disable();
+		++opsCounts[cmd->action];
+	}
+	processor->resetExec();
+}
+
+/// Drives one zone of the allocator with a workload of its own.
+class ZoneWorker : public QThread
+{
+	public:
+		ZoneWorker(ZoneAllocator* allocator, const uint8_t zone, const WorkloadParams& params) :
+			allocator(allocator),
+			zone(zone),
+			params(params),
+			failedCount(0)
+		{
+
+		}
+
+		uint64_t getFailedCount() const
+		{
+			return failedCount;
+		}
+
+	protected:
+		void run()
+		{
+			WorkloadGenerator generator(params);
+			CommandAction action;
+			uint64_t procNumber = 0;
+			uint64_t size = 0;
+			for (uint64_t cmdIndex = 0; cmdIndex < params.cmdsCount; ++cmdIndex)
+			{
+				generator.next(&action, &procNumber, &size);
+				// ids of different workers never collide and never equal NO_NAME
+				uint32_t procId = uint32_t(procNumber * allocator->getZonesCount() + zone + 1);
+				QResultStatus status = QResult_Success;
+				if (action == CommandAction::Allocate) status = allocator->allocate(size, procId, zone);
+				else if (action == CommandAction::Free) status = allocator->free(procId);
+				if (status != QResult_Success) ++failedCount;
+			}
+		}
+
+	private:
+		ZoneAllocator* allocator;
+		uint8_t zone;
+		WorkloadParams params;
+		uint64_t failedCount;
+};
+
+static int replayZones(const QCommandLineParser& parser, QTextStream& out)
+{
+	NameTable names;
+	ZoneAllocator allocator(&names);
+	foreach (const QString& degree, parser.value("zones").split(','))
+	{
+		if (allocator.addZone(degree.toUInt(), parser.value("min").toUInt()) != QResult_Success)
+		{
+			out << "Zone degree " << degree << " is out of range.\n";
+			return 1;
+		}
+	}
+
+	// every zone gets a workload of the same shape scaled to its size, driven by its own thread
+	QVector<ZoneWorker*> workers;
+	for (uint8_t zone = 0; zone < allocator.getZonesCount(); ++zone)
+	{
+		uint8_t degree = allocator.getMemory(zone)->getTotalDegree();
+		WorkloadParams params;
+		params.cmdsCount = parser.value("ops").toULongLong();
+		params.sizeDistribution = SizeDistribution::PowerOfTwo;
+		params.powerOfTwoBias = 0;
+		params.maxSize = (uint64_t(1) << (degree - qMin<uint8_t>(degree, 5))) - 1;
+		params.lifetimeDistribution = LifetimeDistribution::Uniform;
+		params.maxLiveProcesses = UINT32_MAX;
+		params.seed = parser.value("seed").toULongLong() + zone;
+		workers.push_back(new ZoneWorker(&allocator, zone, params));
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	foreach (ZoneWorker* worker, workers)
+	{
+		worker->start();
+	}
+	foreach (ZoneWorker* worker, workers)
+	{
+		worker->wait();
+	}
+	qint64 elapsed = timer.nsecsElapsed();
+
+	uint64_t cmdsCount = parser.value("ops").toULongLong() * workers.size();
+	out << "Commands:      " << cmdsCount << " in " << workers.size() << " threads\n";
+	out << "Time:          " << QString::number(elapsed / 1e6, 'f', 2) << " ms, "
+		<< QString::number(cmdsCount / (elapsed / 1e9) / 1e6, 'f', 3) << " M commands/s\n";
+	out << "Zone  Size       Failed  Allocations  Fallbacks  Utilization  Internal\n";
+	for (uint8_t zone = 0; zone < allocator.getZonesCount(); ++zone)
+	{
+		ZoneStats stats = allocator.getStats(zone);
+		MemoryAnalytics::Step step = MemoryAnalytics::Step();
+		step.liveRequestedBytes = stats.requestedBytes;
+		step.liveGrantedBytes = stats.grantedBytes;
+		out << QString("%1 %2 %3 %4 %5 %6%").arg(
+				   QString::number(zone).leftJustified(5),
+				   MemorySettings::degreeToString(stats.totalDegree).leftJustified(7),
+				   QString::number(workers.at(zone)->getFailedCount()).rightJustified(9),
+				   QString::number(stats.allocationsCount).rightJustified(12),
+				   QString::number(stats.fallbacksCount).rightJustified(10),
+				   QString::number(100.0 * stats.grantedBytes / MemorySettings::degreeToBytes(stats.totalDegree), 'f', 2).rightJustified(11))
+			<< QString::number(MemoryAnalytics::internalFragmentation(step) * 100, 'f', 2).rightJustified(9) << "%\n";
+		delete workers.at(zone);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream out(stdout);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Replays a command trace through the buddy memory simulator.");
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption("cmds", "Command file to replay instead of a random workload.", "file"));
+	parser.addOption(QCommandLineOption("total", "Total memory degree.", "degree", "24"));
+	parser.addOption(QCommandLineOption("min", "Min block degree.", "degree", "4"));
+	parser.addOption(QCommandLineOption("ops", "Commands in the random workload.", "count", "1000000"));
+	parser.addOption(QCommandLineOption("seed", "Seed of the random workload.", "seed", "1"));
+	parser.addOption(QCommandLineOption("analytics", "Write fragmentation statistics of every step to a CSV file.", "file"));
+	parser.addOption(QCommandLineOption("policy", "Placement policy: first, lowest, highest, best, recent or all to compare them.",
+										"name", "first"));
+	parser.addOption(QCommandLineOption("coalescing", "Coalescing of freed blocks: eager or lazy.", "mode", "eager"));
+	parser.addOption(QCommandLineOption("watermark", "Deferred frees which trigger lazy coalescing.", "count", "64"));
+	parser.addOption(QCommandLineOption("zones", "Degrees of memory zones, separated by commas, each driven by its own thread.",
+										"degrees"));
+	parser.addOption(QCommandLineOption("cache-ratio", "Share of allocations made as objects of slab caches.", "value", "0"));
+	parser.addOption(QCommandLineOption("trim", "Grant runs of blocks instead of rounding requests up to a power of two."));
+	parser.addOption(QCommandLineOption("fixed", "Also replay the trace through the memory of a fixed configuration, "
+										"built for total degree 24 with min degree 4."));
+	parser.addOption(QCommandLineOption("touch", "Back memory with a real mapping and touch every stride of bytes "
+										"of blocks when they are granted and before they are freed.", "stride"));
+	parser.addOption(QCommandLineOption("huge-pages", "Pages of the touched memory: regular, transparent or explicit.",
+										"mode", "regular"));
+	parser.addOption(QCommandLineOption("cluster", "Place blocks of the min degree in huge page regions in use first."));
+	parser.addOption(QCommandLineOption("perf", "Count cycles, instructions, cache, branch and TLB misses "
+										"per allocation and free with hardware performance counters, for a single policy without zones."));
+	parser.addOption(QCommandLineOption("trace", "Write trace points of the last replay to a Chrome trace event file.", "file"));
+	parser.process(app);
+
+	if (parser.isSet("trace") && !Tracer::isEnabled())
+	{
+		out << "Tracing is not compiled in, rebuild with \"qmake CONFIG+=tracing\".\n";
+		return 1;
+	}
+	if (parser.isSet("perf") && (parser.isSet("zones") || parser.value("policy") == "all"))
+	{
+		out << "Performance counters are read for a single placement policy without zones only.\n";
+		return 1;
+	}
+	if (parser.isSet("zones"))
+	{
+		int result = replayZones(parser, out);
+		if (result == 0 && parser.isSet("trace") && Tracer::toJson(parser.value("trace")) != QResult_Success)
+		{
+			out << "Cannot write trace to " << parser.value("trace") << ".\n";
+			return 1;
+		}
+		return result;
+	}
+
+	int16_t policy = -1;
+	for (uint8_t index = 0; index < POLICIES_COUNT; ++index)
+	{
+		if (parser.value("policy") == POLICY_NAMES[index]) policy = index;
+	}
+	if (policy < 0 && parser.value("policy") != "all")
+	{
+		out << "Unknown placement policy " << parser.value("policy") << ".\n";
+		return 1;
+	}
+
+	MemorySettings settings;
+	if (settings.setTotalMemoryDegree(parser.value("total").toUInt()) != QResult_Success ||
+			settings.setMinBlockDegree(parser.value("min").toUInt()) != QResult_Success)
+	{
+		out << "Memory degrees are out of range.\n";
+		return 1;
+	}
+	if (parser.value("coalescing") == "lazy") settings.setCoalescingMode(CoalescingMode::LazyCoalescing);
+	else if (parser.value("coalescing") != "eager")
+	{
+		out << "Unknown coalescing mode " << parser.value("coalescing") << ".\n";
+		return 1;
+	}
+	if (settings.setCoalescingWatermark(parser.value("watermark").toUInt()) != QResult_Success)
+	{
+		out << "Coalescing watermark is out of range.\n";
+		return 1;
+	}
+
+	PageMode pageMode = PageMode::Regular;
+	if (parser.value("huge-pages") == "transparent") pageMode = PageMode::TransparentHuge;
+	else if (parser.value("huge-pages") == "explicit") pageMode = PageMode::ExplicitHuge;
+	else if (parser.value("huge-pages") != "regular")
+	{
+		out << "Unknown page mode " << parser.value("huge-pages") << ".\n";
+		return 1;
+	}
+	settings.setHugePageClustering(parser.isSet("cluster"));
+
+	CommandProcessor processor(&settings);
+	processor.setAnalyticsEnabled(parser.isSet("analytics"));
+	processor.setUndoEnabled(false);
+	uint32_t touchStride = parser.value("touch").toUInt();
+	if (parser.isSet("touch") &&
+			(touchStride == 0 || processor.getMemory()->setBackingEnabled(true, pageMode) != QResult_Success))
+	{
+		out << "Cannot map memory of " << MemorySettings::degreeToString(settings.getTotalMemoryDegree())
+			<< " touched with stride " << parser.value("touch") << ".\n";
+		return 1;
+	}
+	if (parser.isSet("cmds"))
+	{
+		if (loadCmds(parser.value("cmds"), &processor) != QResult_Success)
+		{
+			out << "Cannot load commands from " << parser.value("cmds") << ".\n";
+			return 1;
+		}
+	}
+	else
+	{
+		// log-uniform sizes, so small and large requests are equally common
+		WorkloadParams params;
+		params.cmdsCount = parser.value("ops").toULongLong();
+		params.sizeDistribution = SizeDistribution::PowerOfTwo;
+		params.powerOfTwoBias = 0;
+		params.maxSize = (uint64_t(1) << (settings.getTotalMemoryDegree() - qMin<uint8_t>(settings.getTotalMemoryDegree(), 5))) - 1;
+		params.lifetimeDistribution = LifetimeDistribution::Uniform;
+		params.maxLiveProcesses = UINT32_MAX;
+		params.seed = parser.value("seed").toULongLong();
+		params.cacheRatio = parser.value("cache-ratio").toDouble();
+		WorkloadGenerator(params).generate(&processor);
+	}
+
+	uint32_t cmdsCount = processor.getCmdsCount();
+	ReplayResult replayResult;
+	if (policy < 0)
+	{
+		out << "Policy    Time, ms  M commands/s  Failed  Internal  External" << (touchStride != 0 ? "  Touch, ms" : "") << "\n";
+		for (uint8_t index = 0; index < POLICIES_COUNT; ++index)
+		{
+			settings.setPlacementPolicy(PlacementPolicy(index));
+			processor.resetExec();
+			replay(&processor, &replayResult, touchStride, pageMode);
+			out << QString("%1 %2 %3 %4 %5% %6%").arg(
+					   QString(POLICY_NAMES[index]).leftJustified(8),
+					   QString::number(replayResult.elapsed / 1e6, 'f', 2).rightJustified(9),
+					   QString::number(cmdsCount / (replayResult.elapsed / 1e9) / 1e6, 'f', 3).rightJustified(13),
+					   QString::number(replayResult.failedCount).rightJustified(7),
+					   QString::number(MemoryAnalytics::internalFragmentation(replayResult.lastStep) * 100, 'f', 2).rightJustified(8),
+					   QString::number(MemoryAnalytics::externalFragmentation(replayResult.lastStep) * 100, 'f', 2).rightJustified(8));
+			if (touchStride != 0)
+			{
+				out << QString::number(replayResult.touchElapsed / 1e6, 'f', 2).rightJustified(11);
+			}
+			out << "\n";
+		}
+		return 0;
+	}
+
+	settings.setPlacementPolicy(PlacementPolicy(policy));
+	ReplayResult roundedResult;
+	if (parser.isSet("trim"))
+	{
+		// the same trace with rounding, to see what trimming saves
+		processor.resetExec();
+		replay(&processor, &roundedResult);
+		settings.setTailTrimming(true);
+	}
+	processor.resetExec();
+	Tracer::clear();
+	replay(&processor, &replayResult, touchStride, pageMode);
+	uint32_t failedCount = replayResult.failedCount;
+	uint32_t peakNodes = replayResult.peakNodes;
+	qint64 elapsed = replayResult.elapsed;
+	const MemoryAnalytics::Step& lastStep = replayResult.lastStep;
+
+	processor.queryInfo();
+	out << "Commands:      " << cmdsCount << " (" << failedCount << " failed)\n";
+	out << "Time:          " << QString::number(elapsed / 1e6, 'f', 2) << " ms, "
+		<< QString::number(cmdsCount / (elapsed / 1e9) / 1e6, 'f', 3) << " M commands/s\n";
+	if (touchStride != 0)
+	{
+		out << "Touched:       " << MemorySettings::bytesToString(replayResult.touchedBytes) << " with stride " << touchStride
+			<< " in " << QString::number(replayResult.touchElapsed / 1e6, 'f', 2) << " ms on "
+			<< BackingStore::pageModeToString(replayResult.pageMode) << " (checksum " << replayResult.checksum << ")\n";
+		if (replayResult.pageMode != PageMode::Regular)
+		{
+			out << "Backed:        " << MemorySettings::bytesToString(replayResult.hugePageBytes) << " on huge pages at the end\n";
+		}
+	}
+	if (touchStride != 0 || parser.isSet("cluster"))
+	{
+		out << "Huge pages:    " << replayResult.hugePages.freeCount << " free, " << replayResult.hugePages.partialCount
+			<< " partially used, " << replayResult.hugePages.fullCount << " fully used regions of "
+			<< MemorySettings::degreeToString(qMin<uint8_t>(settings.getTotalMemoryDegree(), BackingStore::HUGE_PAGE_DEGREE)) << "\n";
+	}
+	out << "Tree updates:  " << replayResult.splitsCount << " splits, " << replayResult.mergesCount << " merges\n";
+	for (uint8_t action = 0; action < COMMAND_ACTIONS_COUNT; ++action)
+	{
+		// the slowest command is worth a look in the trace
+		const LatencyHistogram& latency = processor.getLatency(CommandAction(action));
+		if (latency.getCount() == 0) continue;
+		out << QString("%1 %2 (mean %3, slowest is command %4)\n").arg(
+				   QString("Latency of %1:").arg(ACTION_NAMES[action]).leftJustified(26),
+				   latency.toString(), LatencyHistogram::durationToString(latency.getMean()),
+				   QString::number(latency.getMaxSample()));
+	}
+	SlabStats slabStats = processor.getSlabs()->getStats();
+	if (slabStats.cachesCount != 0)
+	{
+		out << "Slab caches:   " << slabStats.cachesCount << " caches, " << slabStats.slabsCount << " slabs, "
+			<< slabStats.objectsCount << " objects, " << MemorySettings::bytesToString(slabStats.objectBytes) << " of "
+			<< MemorySettings::bytesToString(slabStats.slabBytes) << " used\n";
+	}
+	out << "Memory in use: " << MemoryInfo::usedMemory << " in " << MemoryInfo::blocksQuantity << " blocks\n";
+	out << "Node size:     " << sizeof(Block) << " bytes (pointer-based layout: " << sizeof(PointerBlockLayout)
+		<< " bytes plus a heap allocation per node and per pair)\n";
+	out << "Peak nodes:    " << peakNodes << " (" << MemorySettings::bytesToString(uint64_t(peakNodes) * sizeof(Block))
+		<< " vs " << MemorySettings::bytesToString(uint64_t(peakNodes) * sizeof(PointerBlockLayout)) << ")\n";
+	out << "Fragmentation: internal " << QString::number(MemoryAnalytics::internalFragmentation(lastStep) * 100, 'f', 2)
+		<< "%, external " << QString::number(MemoryAnalytics::externalFragmentation(lastStep) * 100, 'f', 2) << "%\n";
+	if (parser.isSet("trim"))
+	{
+		out << "Tail trimming: internal " << QString::number(MemoryAnalytics::internalFragmentation(roundedResult.lastStep) * 100, 'f', 2)
+			<< "% -> " << QString::number(MemoryAnalytics::internalFragmentation(lastStep) * 100, 'f', 2) << "%, granted "
+			<< MemorySettings::bytesToString(roundedResult.lastStep.liveGrantedBytes) << " -> "
+			<< MemorySettings::bytesToString(lastStep.liveGrantedBytes) << ", failed " << roundedResult.failedCount
+			<< " -> " << failedCount << "\n";
+	}
+	if (parser.isSet("fixed"))
+	{
+		if (settings.getTotalMemoryDegree() != 24 || settings.getMinBlockDegree() != 4)
+		{
+			out << "Fixed memory is built for total degree 24 with min degree 4 only.\n";
+			return 1;
+		}
+		ReplayResult fixedResult;
+		replayFixed<24, 4>(&processor, &fixedResult);
+		out << "Fixed memory:  " << QString::number(fixedResult.elapsed / 1e6, 'f', 2) << " ms, "
+			<< QString::number(cmdsCount / (fixedResult.elapsed / 1e9) / 1e6, 'f', 3) << " M commands/s, "
+			<< fixedResult.failedCount << " failed, placed as by the lowest address policy\n";
+	}
+	if (parser.isSet("trace") && Tracer::toJson(parser.value("trace")) != QResult_Success)
+	{
+		out << "Cannot write trace to " << parser.value("trace") << ".\n";
+		return 1;
+	}
+
+	if (parser.isSet("analytics"))
+	{
+		MemoryAnalytics* analytics = processor.getAnalytics();
+		out << "Failures:      " << analytics->getFailuresCount(FailureReason::OutOfMemory) << " no free block, "
+			<< analytics->getFailuresCount(FailureReason::TooLarge) << " too large, "
+			<< analytics->getFailuresCount(FailureReason::DuplicateName) << " duplicate name, "
+			<< analytics->getFailuresCount(FailureReason::NotAllocated) << " not allocated, "
+			<< analytics->getFailuresCount(FailureReason::SizeMismatch) << " size mismatch\n";
+		if (processor.analyticsToCsv(parser.value("analytics")) != QResult_Success)
+		{
+			out << "Cannot write analytics to " << parser.value("analytics") << ".\n";
+			return 1;
+		}
+	}
+
+	if (parser.isSet("perf"))
+	{
+		// counters are often denied in containers, the benchmark goes on without them
+		PerfCounters wholeCounters;
+		PerfCounters actionCounters[2];
+		if (wholeCounters.open() != QResult_Success || actionCounters[CommandAction::Allocate].open() != QResult_Success ||
+				actionCounters[CommandAction::Free].open() != QResult_Success)
+		{
+			out << "Performance counters are unavailable (" << wholeCounters.getError() << ").\n";
+			return 0;
+		}
+
+		uint32_t opsCounts[2];
+		replayCounted(&processor, &wholeCounters, actionCounters, opsCounts);
+		uint32_t opsCount = opsCounts[CommandAction::Allocate] + opsCounts[CommandAction::Free];
+		out << "Counter          per allocate    per free  per operation\n";
+		for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+		{
+			QStringList values;
+			for (uint8_t action = 0; action < 3; ++action)
+			{
+				const PerfCounters& counters = (action < 2 ? actionCounters[action] : wholeCounters);
+				uint32_t count = (action < 2 ? opsCounts[action] : opsCount);
+				values << (counters.isAvailable(PerfEvent(event)) && count != 0 ?
+							   QString::number(double(counters.getValue(PerfEvent(event))) / count, 'f', 2) : QString("n/a"));
+			}
+			out << QString("%1 %2 %3 %4\n").arg(PerfCounters::eventToString(PerfEvent(event)).leftJustified(13),
+												 values.at(0).rightJustified(15), values.at(1).rightJustified(11),
+												 values.at(2).rightJustified(14));
+		}
+		if (!wholeCounters.getError().isEmpty())
+		{
+			out << "Unavailable:   " << wholeCounters.getError() << "\n";
+		}
+	}
+
+	return 0;
+}
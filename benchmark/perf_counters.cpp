@@ -0,0 +1,161 @@
+#include "perf_counters.h"
+
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+PerfCounters::PerfCounters()
+{
+	for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+	{
+		descriptors[event] = -1;
+	}
+}
+
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+QResultStatus PerfCounters::open()
+{
+	close();
+#ifdef Q_OS_LINUX
+	// cache events are read misses of the level
+	const uint32_t types[PERF_EVENTS_COUNT] = {
+		PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+		PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE
+	};
+	const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	const uint64_t configs[PERF_EVENTS_COUNT] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_L1D | readMiss,
+		PERF_COUNT_HW_CACHE_LL | readMiss, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_DTLB | readMiss
+	};
+
+	bool isAnyOpened = false;
+	for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+	{
+		// user mode only, which a paranoid level of 2 still allows
+		perf_event_attr attr;
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = types[event];
+		attr.config = configs[event];
+		attr.disabled = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		descriptors[event] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		if (descriptors[event] < 0)
+		{
+			error += QString("%1%2 (%3)").arg(error.isEmpty() ? "" : ", ", eventToString(PerfEvent(event)), strerror(errno));
+		}
+		else
+		{
+			isAnyOpened = true;
+		}
+	}
+	return isAnyOpened ? QResult_Success : QResult_ActionUnavailable;
+#else
+	error = "performance counters are read on Linux only";
+	return QResult_NotImplemented;
+#endif
+}
+
+void PerfCounters::close()
+{
+	for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+	{
+#ifdef Q_OS_LINUX
+		if (descriptors[event] >= 0) ::close(descriptors[event]);
+#endif
+		descriptors[event] = -1;
+	}
+	error.clear();
+}
+
+void PerfCounters::reset()
+{
+#ifdef Q_OS_LINUX
+	for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+	{
+		if (descriptors[event] >= 0) ioctl(descriptors[event], PERF_EVENT_IOC_RESET, 0);
+	}
+#endif
+}
+
+void PerfCounters::enable()
+{
+#ifdef Q_OS_LINUX
+	for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+	{
+		if (descriptors[event] >= 0) ioctl(descriptors[event], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+void PerfCounters::disable()
+{
+#ifdef Q_OS_LINUX
+	for (uint8_t event = 0; event < PERF_EVENTS_COUNT; ++event)
+	{
+		if (descriptors[event] >= 0) ioctl(descriptors[event], PERF_EVENT_IOC_DISABLE, 0);
+	}
+#endif
+}
+
+bool PerfCounters::isAvailable(const PerfEvent event) const
+{
+	return descriptors[uint8_t(event)] >= 0;
+}
+
+uint64_t PerfCounters::getValue(const PerfEvent event) const
+{
+#ifdef Q_OS_LINUX
+	// value, time enabled and time running
+	uint64_t values[3] = { 0, 0, 0 };
+	if (!isAvailable(event) || read(descriptors[uint8_t(event)], values, sizeof(values)) != sizeof(values))
+	{
+		return 0;
+	}
+	if (values[2] != 0 && values[2] < values[1])
+	{
+		return uint64_t(double(values[0]) * values[1] / values[2]);
+	}
+	return values[0];
+#else
+	Q_UNUSED(event);
+	return 0;
+#endif
+}
+
+QString PerfCounters::getError() const
+{
+	return error;
+}
+
+QString PerfCounters::eventToString(const PerfEvent event)
+{
+	switch (event)
+	{
+		case PerfEvent::Cycles:
+			return "cycles";
+		case PerfEvent::Instructions:
+			return "instructions";
+		case PerfEvent::L1DataMisses:
+			return "L1D misses";
+		case PerfEvent::LastLevelMisses:
+			return "LLC misses";
+		case PerfEvent::BranchMisses:
+			return "branch misses";
+		case PerfEvent::DataTlbMisses:
+			return "dTLB misses";
+		default:
+			return "unknown";
+	}
+}
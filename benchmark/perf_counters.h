@@ -0,0 +1,51 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+
+#include "common.h"
+
+enum class PerfEvent
+{
+	Cycles,
+	Instructions,
+	L1DataMisses,
+	LastLevelMisses,
+	BranchMisses,
+	DataTlbMisses
+};
+const uint8_t PERF_EVENTS_COUNT = 6;
+
+/// Hardware counters of the calling thread in user mode, opened with perf_event_open on Linux.
+/// Events the kernel refuses, as in containers without perf access, stay unavailable and the rest still count.
+class PerfCounters
+{
+	public:
+		PerfCounters();
+		~PerfCounters();
+
+		/// Opens every event, fails only when none of them is available.
+		QResultStatus open();
+		void close();
+		/// Zeroes the counts, the counters stay enabled or disabled.
+		void reset();
+		/// Counters count only between enable() and disable(), so a workload may be measured in parts.
+		void enable();
+		void disable();
+		bool isAvailable(const PerfEvent event) const;
+		/// Count since the last reset, scaled up when the kernel multiplexed the event.
+		uint64_t getValue(const PerfEvent event) const;
+		/// Events which could not be opened with the reasons, empty when all were.
+		QString getError() const;
+		static QString eventToString(const PerfEvent event);
+
+	private:
+		int descriptors[PERF_EVENTS_COUNT];
+		QString error;
+
+		PerfCounters(const PerfCounters&);
+		PerfCounters& operator=(const PerfCounters&);
+};
+
+#endif // PERF_COUNTERS_H
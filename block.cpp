@@ -1,72 +1,42 @@
 #include "block.h"
 
-Block::Block(const uint8_t sizeDegree, const uint8_t minDegree) : Block()
-{
-	this->sizeDegree = sizeDegree;
-	this->minDegree = minDegree;
-}
+const uint32_t Block::NO_BLOCK;
 
-Block::~Block()
+Block::Block() :
+	parent(NO_BLOCK),
+	childFirst(NO_BLOCK),
+	position(0),
+	procId(NameTable::NO_NAME),
+	sizeDegree(0),
+	longestFree(0)
 {
-	mergeChilds();
-}
 
-Block::Block(Block* parent) : Block()
-{
-	this->parent = parent;
-	this->sizeDegree = parent->getDegree() - 1;
-	this->minDegree = parent->getMinDegree();
 }
 
-QPair<Block*, Block*>* Block::split()
+Block::Block(const uint8_t degree, const uint32_t parent, const uint32_t position) : Block()
 {
-	if (childFirst != nullptr || childSecond != nullptr || sizeDegree == minDegree)
-	{
-		return nullptr;
-	}
-
-	QPair<Block*, Block*>* pair = new QPair<Block*, Block*>();
-	childFirst = new Block(this);
-	childSecond = new Block(this);
-
-	childFirst->beginAddress = this->beginAddress;
-	childSecond->beginAddress = this->beginAddress + MemorySettings::degreeToBytes(sizeDegree) / 2;
-
-	pair->first = childFirst;
-	pair->second = childSecond;
-	return pair;
-}
-
-QResultStatus Block::merge(Block* block)
-{
-	QResultStatus resultStatus = QResult_Success;
-	if (parent != nullptr && block != nullptr && block->isChildOf(parent) && block->isFree() && this->isFree())
-	{
-		this->parent->mergeChilds();
-	}
-	else
-	{
-		resultStatus = QResult_ActionUnavailable;
-	}
-	return resultStatus;
+	this->sizeDegree = degree;
+	this->parent = parent;
+	this->position = position;
+	this->longestFree = degree + 1;
 }
 
-bool Block::isChildOf(const Block* parent) const
+bool Block::isFree() const
 {
-	return this->parent == parent;
+	return procId == NameTable::NO_NAME && childFirst == NO_BLOCK;
 }
 
-bool Block::isFree() const
+bool Block::hasChilds() const
 {
-	return !(procName.length()) && childFirst == nullptr && childSecond == nullptr;
+	return childFirst != NO_BLOCK;
 }
 
 QResultStatus Block::free()
 {
 	QResultStatus resultStatus = QResult_Success;
-	if (childFirst == nullptr && childSecond == nullptr)
+	if (childFirst == NO_BLOCK)
 	{
-		procName = "";
+		procId = NameTable::NO_NAME;
 	}
 	else
 	{
@@ -75,12 +45,12 @@ QResultStatus Block::free()
 	return resultStatus;
 }
 
-QResultStatus Block::setProcName(const QString& name)
+QResultStatus Block::setProcId(const uint32_t id)
 {
 	QResultStatus resultStatus = QResult_Success;
 	if (isFree())
 	{
-		this->procName = name;
+		this->procId = id;
 	}
 	else
 	{
@@ -89,9 +59,9 @@ QResultStatus Block::setProcName(const QString& name)
 	return resultStatus;
 }
 
-QString Block::getProcName() const
+uint32_t Block::getProcId() const
 {
-	return procName;
+	return procId;
 }
 
 uint8_t Block::getDegree() const
@@ -99,60 +69,39 @@ uint8_t Block::getDegree() const
 	return sizeDegree;
 }
 
-uint8_t Block::getMinDegree() const
-{
-	return minDegree;
-}
-
-bool Block::hasChilds() const
-{
-	return childFirst != nullptr || childSecond != nullptr;
-}
-
-Block*Block::getParent() const
+uint32_t Block::getParent() const
 {
 	return parent;
 }
 
-Block*Block::getFirstChild() const
+uint32_t Block::getFirstChild() const
 {
 	return childFirst;
 }
 
-Block*Block::getSecondChild() const
+uint32_t Block::getSecondChild() const
 {
-	return childSecond;
+	return childFirst == NO_BLOCK ? NO_BLOCK : childFirst + 1;
 }
 
-QColor Block::getColor() const
+uint32_t Block::getPosition() const
 {
-	return color;
+	return position;
 }
 
-uint64_t Block::getBeginAddress() const
+int16_t Block::getLongestFreeDegree() const
 {
-	return beginAddress;
+	return int16_t(longestFree) - 1;
 }
 
-void Block::mergeChilds()
+uint64_t Block::getBeginAddress() const
 {
-
-	if (childFirst != nullptr && childFirst->isFree() &&
-		childSecond != nullptr && childSecond->isFree())
-	{
-		delete childFirst;
-		delete childSecond;
-
-		childFirst = nullptr;
-		childSecond = nullptr;
-	}
+	return uint64_t(position) << sizeDegree;
 }
 
-Block::Block()
+QColor Block::getColor(const QString& procName)
 {
-	this->parent = nullptr;
-	this->childFirst = nullptr;
-	this->childSecond = nullptr;
-	color = QColor(rand()%256, rand()%256, rand()%256);
-	beginAddress = 0;
+	// the same name always gets the same color, so nothing has to be stored per block
+	uint hash = qHash(procName);
+	return QColor(hash & 0xff, (hash >> 8) & 0xff, (hash >> 16) & 0xff);
 }
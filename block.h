@@ -3,54 +3,52 @@
 
 #include <QtCore/qglobal.h>
 #include <QString>
-#include <QPair>
-#include <QVector>
 #include <QColor>
-#include <cstdlib>
-#include <ctime>
+#include <QHash>
 
 #include "common.h"
 #include "memory_settings.h"
+#include "name_table.h"
 
+/// Node of the buddy tree.
+/// Nodes live in the pool owned by Memory and refer to each other by 32-bit indices.
+/// Children of a node always occupy two neighbouring slots, so only the first one is stored.
+/// The begin address is derived from the position of the block inside its level.
+/// Every node also knows the largest free block beneath it, so a fitting block is reached from the root.
 class Block
 {
 	public:
+		static const uint32_t NO_BLOCK = UINT32_MAX;
+
 		Block();
-		Block(const uint8_t degree, const uint8_t minDegree);
-		~Block();
-		Block(Block* parent);
+		Block(const uint8_t degree, const uint32_t parent, const uint32_t position);
 
-		QPair<Block*, Block*>* split();
-		QResultStatus merge(Block* block);
-		bool isChildOf(const Block* parent) const;
 		bool isFree() const;
+		bool hasChilds() const;
 		QResultStatus free();
 
-		QResultStatus setProcName(const QString& name);
-		QString getProcName() const;
+		QResultStatus setProcId(const uint32_t id);
+		uint32_t getProcId() const;
 		uint8_t getDegree() const;
-		uint8_t getMinDegree() const;
-		bool hasChilds() const;
-		Block* getParent() const;
-		Block* getFirstChild() const;
-		Block* getSecondChild() const;
-		QColor getColor() const;
+		uint32_t getParent() const;
+		uint32_t getFirstChild() const;
+		uint32_t getSecondChild() const;
+		uint32_t getPosition() const;
+		int16_t getLongestFreeDegree() const;
 		uint64_t getBeginAddress() const;
 
-
-	protected:
-		void mergeChilds();
-		uint64_t beginAddress;
+		static QColor getColor(const QString& procName);
 
 	private:
+		friend class Memory;
+
+		uint32_t parent;
+		uint32_t childFirst;
+		uint32_t position;
+		uint32_t procId;
 		uint8_t sizeDegree;
-		uint8_t minDegree;
-		QString procName;
-		Block* parent;
-		Block* childFirst;
-		Block* childSecond;
-		QColor color;
+		/// Degree plus one of the largest free block in the subtree, zero when there is none.
+		uint8_t longestFree;
 };
 
-
 #endif // BLOCK_H
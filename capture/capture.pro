@@ -0,0 +1,21 @@
+#-------------------------------------------------
+#
+# Converts allocator captures of the preload library into command files
+#
+#-------------------------------------------------
+
+QT       += core gui charts
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = CP_SSW_capture
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+HEADERS += ../preload/malloc_trace.h
+SOURCES += main.cpp
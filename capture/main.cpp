@@ -0,0 +1,120 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QSet>
+#include <QTextStream>
+#include <algorithm>
+
+#include "command_processor.h"
+#include "../preload/malloc_trace.h"
+
+static QResultStatus loadCapture(const QString& path, QVector<MallocTraceRecord>* records)
+{
+	QFile file(path);
+	if (!file.open(QFile::ReadOnly)) {
+		return QResult_NotFound;
+	}
+
+	QByteArray magic = file.read(sizeof(MALLOC_TRACE_MAGIC));
+	if (magic != QByteArray(MALLOC_TRACE_MAGIC, sizeof(MALLOC_TRACE_MAGIC)))
+	{
+		return QResult_IncorrectData;
+	}
+	// a record cut short by a crash of the traced program is dropped
+	qint64 bytes = (file.size() - magic.size()) / sizeof(MallocTraceRecord) * sizeof(MallocTraceRecord);
+	records->resize(int(bytes / sizeof(MallocTraceRecord)));
+	if (file.read(reinterpret_cast<char*>(records->data()), bytes) != bytes)
+	{
+		return QResult_UnexpectedError;
+	}
+	return QResult_Success;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream err(stderr);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Converts a capture of the preload library into a command file, "
+									 "blocks are named by their addresses.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("capture", "Capture written by a program run with LD_PRELOAD=libCP_SSW_preload.so.");
+	parser.addOption(QCommandLineOption("out", "Output file, standard output by default.", "file"));
+	parser.process(app);
+
+	if (parser.positionalArguments().size() != 1)
+	{
+		parser.showHelp(1);
+	}
+
+	QVector<MallocTraceRecord> records;
+	if (loadCapture(parser.positionalArguments().first(), &records) != QResult_Success)
+	{
+		err << "Cannot load the capture " << parser.positionalArguments().first() << ".\n";
+		return 1;
+	}
+
+	QFile file;
+	bool isOpened = false;
+	if (parser.isSet("out"))
+	{
+		file.setFileName(parser.value("out"));
+		isOpened = file.open(QFile::WriteOnly | QFile::Text);
+	}
+	else
+	{
+		isOpened = file.open(stdout, QFile::WriteOnly);
+	}
+	if (!isOpened)
+	{
+		err << "Cannot open the output file.\n";
+		return 1;
+	}
+
+	// threads append their records in chunks, the sequence restores the order of the calls
+	std::sort(records.begin(), records.end(), [](const MallocTraceRecord& first, const MallocTraceRecord& second) {
+		return first.sequence < second.sequence;
+	});
+
+	QSet<quint64> liveAddresses;
+	QSet<uint32_t> threads;
+	uint64_t cmdsCount = 0;
+	uint64_t unknownFreesCount = 0;
+	uint64_t missedFreesCount = 0;
+	QTextStream stream(&file);
+	foreach (const MallocTraceRecord& record, records)
+	{
+		threads.insert(record.thread);
+		QString name = QString("p%1").arg(quint64(record.address), 0, 16);
+		if (record.op == MallocTraceAllocate)
+		{
+			if (liveAddresses.contains(record.address))
+			{
+				// the block was released by a call the library does not wrap
+				stream << Command(CommandAction::Free, name, 0).cmdToStr() << "\n";
+				++missedFreesCount;
+				++cmdsCount;
+			}
+			liveAddresses.insert(record.address);
+			stream << Command(CommandAction::Allocate, name, record.size).cmdToStr() << "\n";
+			++cmdsCount;
+		}
+		else if (liveAddresses.remove(record.address))
+		{
+			stream << Command(CommandAction::Free, name, 0).cmdToStr() << "\n";
+			++cmdsCount;
+		}
+		else
+		{
+			// blocks allocated before the library was loaded or inside it
+			++unknownFreesCount;
+		}
+	}
+	stream.flush();
+
+	err << "Converted " << records.size() << " records of " << threads.size() << " threads into " << cmdsCount
+		<< " commands, " << unknownFreesCount << " frees of unknown blocks dropped, " << missedFreesCount
+		<< " missing frees added, " << liveAddresses.size() << " blocks live at exit\n";
+	return 0;
+}
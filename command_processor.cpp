@@ -1,30 +1,74 @@
 #include "command_processor.h"
 
+#include <QElapsedTimer>
+
 CommandProcessor::CommandProcessor(MemorySettings* settings) :
 	cmds(new QVector<Command*>()),
-	mem(new Memory(settings)),
-	nextCmd(nullptr)
+	names(new NameTable()),
+	mem(new Memory(settings, names)),
+	slabs(new SlabAllocator(mem, names)),
+	analytics(new MemoryAnalytics()),
+	isAnalyticsEnabled(false),
+	latencies(COMMAND_ACTIONS_COUNT),
+	timedCmdsCount(0),
+	nextCmdIndex(-1),
+	isUndoEnabled(true)
 {
-
+	mem->setUndoEnabled(isUndoEnabled);
+	slabs->setUndoEnabled(isUndoEnabled);
 }
 
 CommandProcessor::~CommandProcessor()
 {
 	cmds->clear();
 	delete cmds;
+	delete slabs;
 	delete mem;
+	delete analytics;
+	delete names;
 }
 
 void CommandProcessor::addCmd(Command* cmd)
 {
+	cmd->blockId = names->intern(cmd->blockName);
+	cmd->blockDegree = MemorySettings::bytesToDegree(cmd->blockSize);
 	cmds->push_back(cmd);
-	if (nextCmd == nullptr)
+	if (nextCmdIndex < 0)
+	{
+		nextCmdIndex = cmds->size() - 1;
+	}
+}
+
+void CommandProcessor::addCmds(const QVector<Command*>& newCmds)
+{
+	if (newCmds.isEmpty())
+	{
+		return;
+	}
+
+	QVector<uint64_t> sizes(newCmds.size());
+	QVector<uint8_t> degrees(newCmds.size());
+	for (int cmdIndex = 0; cmdIndex < newCmds.size(); ++cmdIndex)
 	{
-		nextCmd = cmd;
+		sizes[cmdIndex] = newCmds.at(cmdIndex)->blockSize;
+	}
+	MemorySettings::bytesToDegrees(sizes.constData(), degrees.data(), newCmds.size());
+
+	cmds->reserve(cmds->size() + newCmds.size());
+	for (int cmdIndex = 0; cmdIndex < newCmds.size(); ++cmdIndex)
+	{
+		Command* cmd = newCmds.at(cmdIndex);
+		cmd->blockId = names->intern(cmd->blockName);
+		cmd->blockDegree = degrees.at(cmdIndex);
+		cmds->push_back(cmd);
+	}
+	if (nextCmdIndex < 0)
+	{
+		nextCmdIndex = cmds->size() - newCmds.size();
 	}
 }
 
-Command* CommandProcessor::getCmd(const uint16_t index)
+Command* CommandProcessor::getCmd(const uint32_t index)
 {
 	if (getCmdsCount() <= index)
 	{
@@ -46,7 +90,7 @@ QVector<Command*>* CommandProcessor::getAllCmds()
 	return clone;
 }
 
-QResultStatus CommandProcessor::removeCmd(const uint16_t index)
+QResultStatus CommandProcessor::removeCmd(const uint32_t index)
 {
 	QResultStatus resultStatus = QResult_Success;
 	if (getCmdsCount() <= index)
@@ -55,7 +99,7 @@ QResultStatus CommandProcessor::removeCmd(const uint16_t index)
 	}
 	else
 	{
-		if (index == getNextCmdIndex())
+		if ((int32_t)index == getNextCmdIndex())
 		{
 			cmds->removeAt(index);
 			resetExec();
@@ -63,8 +107,17 @@ QResultStatus CommandProcessor::removeCmd(const uint16_t index)
 		else
 		{
 			cmds->removeAt(index);
+			invalidateCheckpoints(index);
+			// indexes of executed commands are shifted
+			history.clear();
+			mem->clearUndoLog();
+			slabs->clearUndoLog();
+			// keeping the same command as the next one
+			if ((int32_t)index < nextCmdIndex)
+			{
+				--nextCmdIndex;
+			}
 		}
-
 	}
 	return resultStatus;
 }
@@ -72,37 +125,19 @@ QResultStatus CommandProcessor::removeCmd(const uint16_t index)
 void CommandProcessor::removeAllCmds()
 {
 	cmds->clear();
+	checkpoints.clear();
+	history.clear();
+	nextCmdIndex = -1;
 }
 
-uint16_t CommandProcessor::getCmdsCount() const
+uint32_t CommandProcessor::getCmdsCount() const
 {
 	return cmds->size();
 }
 
 QString CommandProcessor::getRandomName() const
 {
-	QString name = "";
-	uint64_t counter = 0;
-
-	bool isNameUnique = false;
-	while (!isNameUnique)
-	{
-		name = QString("P%1").arg(QString::number(counter++));
-		try
-		{
-			foreach (Command* cmd, *cmds)
-			{
-				if (cmd->blockName == name) throw true;
-			}
-			throw false;
-		}
-		catch (bool isFound)
-		{
-			isNameUnique = !isFound;
-		}
-	}
-
-	return name;
+	return names->getUniqueName();
 }
 
 QResultStatus CommandProcessor::execNextCmd(QString* result)
@@ -111,12 +146,37 @@ QResultStatus CommandProcessor::execNextCmd(QString* result)
 
 	if (getNextCmdIndex() >= 0)
 	{
-		Command* cmd = nextCmd;
+		Command* cmd = cmds->at(nextCmdIndex);
+		if (nextCmdIndex % CHECKPOINT_INTERVAL == 0 && !checkpoints.contains(nextCmdIndex))
+		{
+			Checkpoint checkpoint;
+			mem->saveState(&checkpoint.state);
+			slabs->saveState(&checkpoint.slabsState);
+			checkpoint.analyticsSteps = analytics->getStepsCount();
+			checkpoints.insert(nextCmdIndex, checkpoint);
+		}
+		if (isUndoEnabled)
+		{
+			ExecutedCmd executedCmd;
+			executedCmd.cmdIndex = nextCmdIndex;
+			executedCmd.undoOpsCount = mem->getUndoOpsCount();
+			executedCmd.slabUndoOpsCount = slabs->getUndoOpsCount();
+			executedCmd.analyticsSteps = analytics->getStepsCount();
+			history.push_back(executedCmd);
+		}
 
+		// only the calls of the allocators are timed, the text of the result is not
+		QElapsedTimer timer;
+		qint64 elapsed = 0;
+		// reported by the allocator which refused the command
+		FailureReason failure = FailureReason::None;
 		switch (cmd->action)
 		{
 			case CommandAction::Allocate:
-				resultStatus = mem->allocate(cmd->blockSize, cmd->blockName);
+				timer.start();
+				resultStatus = mem->allocate(cmd->blockSize, cmd->blockId, cmd->blockDegree);
+				elapsed = timer.nsecsElapsed();
+				failure = mem->getLastFailure();
 				if (resultStatus != QResult_Success)
 				{
 					result->append(QString("Command cannot be done."));
@@ -134,7 +194,20 @@ QResultStatus CommandProcessor::execNextCmd(QString* result)
 				}
 				break;
 			case CommandAction::Free:
-				resultStatus = mem->free(cmd->blockName);
+				// a page freed behind the slab allocator would leave its objects without memory
+				timer.start();
+				if (slabs->isPage(cmd->blockId))
+				{
+					resultStatus = QResult_ActionUnavailable;
+					elapsed = timer.nsecsElapsed();
+					failure = FailureReason::SlabPage;
+				}
+				else
+				{
+					resultStatus = mem->free(cmd->blockId);
+					elapsed = timer.nsecsElapsed();
+					failure = mem->getLastFailure();
+				}
 				if (resultStatus == QResult_Success)
 				{
 					if (result != nullptr)
@@ -156,11 +229,71 @@ QResultStatus CommandProcessor::execNextCmd(QString* result)
 					throw QResult_NullPointer;
 				}
 
-				result->append(mem->query(cmd->blockName));
+				// a query is the text it builds
+				if (!SlabAllocator::getCacheName(cmd->blockName).isEmpty())
+				{
+					timer.start();
+					result->append(slabs->query(cmd->blockId));
+					elapsed = timer.nsecsElapsed();
+				}
+				else
+				{
+					timer.start();
+					result->append(mem->query(cmd->blockId));
+					elapsed = timer.nsecsElapsed();
+				}
+				break;
+			case CommandAction::CacheAllocate:
+				timer.start();
+				resultStatus = slabs->allocate(cmd->blockName, cmd->blockSize, cmd->blockId);
+				elapsed = timer.nsecsElapsed();
+				failure = slabs->getLastFailure();
+				if (result != nullptr)
+				{
+					if (resultStatus == QResult_Success)
+					{
+						result->append(QString("Successfully allocated object %1.").arg(cmd->blockName));
+					}
+					else
+					{
+						result->append(QString("No space found for object %1.").arg(cmd->blockName));
+					}
+				}
+				break;
+			case CommandAction::CacheFree:
+				timer.start();
+				resultStatus = slabs->free(cmd->blockId);
+				elapsed = timer.nsecsElapsed();
+				failure = slabs->getLastFailure();
+				if (result != nullptr)
+				{
+					if (resultStatus == QResult_Success)
+					{
+						result->append(QString("Object %1 freed.").arg(cmd->blockName));
+					}
+					else
+					{
+						result->append(QString("Object free failed for %1.").arg(cmd->blockName));
+					}
+				}
 				break;
 			default:
 				resultStatus = QResult_IncorrectData;
 		}
+		// commands replayed by seeking or run again after stepping back are timed once a pass
+		if (cmd->action < COMMAND_ACTIONS_COUNT && nextCmdIndex >= timedCmdsCount)
+		{
+			latencies[cmd->action].record(elapsed, nextCmdIndex);
+			timedCmdsCount = nextCmdIndex + 1;
+		}
+
+		if (isAnalyticsEnabled)
+		{
+			uint64_t requestedBytes = (cmd->action == CommandAction::Allocate || cmd->action == CommandAction::CacheAllocate ?
+										   cmd->blockSize : 0);
+			analytics->record(mem, nextCmdIndex, Command::actionToChar(cmd->action), cmd->blockId,
+							  requestedBytes, resultStatus, failure);
+		}
 	}
 	else
 	{
@@ -171,59 +304,158 @@ QResultStatus CommandProcessor::execNextCmd(QString* result)
 
 	if (resultStatus == QResult_Success)
 	{
-		for (uint16_t index = 0; index < cmds->size(); ++index)
+		if (nextCmdIndex == cmds->size() - 1)
 		{
-			if (cmds->at(index) == nextCmd)
-			{
-				if (index == cmds->size() - 1)
-				{
-					nextCmd = cmds->at(0);
-				}
-				else
-				{
-					nextCmd = cmds->at(index+1);
-				}
-				break;
-			}
+			// the next pass starts from the current state
+			nextCmdIndex = 0;
+			timedCmdsCount = 0;
+			checkpoints.clear();
+			history.clear();
+			mem->clearUndoLog();
+			slabs->clearUndoLog();
+		}
+		else
+		{
+			++nextCmdIndex;
 		}
 	}
 
 	return resultStatus;
 }
 
+void CommandProcessor::skipNextCmd()
+{
+	if (getNextCmdIndex() >= 0)
+	{
+		nextCmdIndex = (nextCmdIndex + 1) % cmds->size();
+		if (nextCmdIndex == 0)
+		{
+			timedCmdsCount = 0;
+			checkpoints.clear();
+			history.clear();
+			mem->clearUndoLog();
+			slabs->clearUndoLog();
+		}
+	}
+}
+
 void CommandProcessor::resetExec()
 {
-	if (cmds->size() > 0)
+	rewind();
+	timedCmdsCount = 0;
+	for (uint8_t action = 0; action < COMMAND_ACTIONS_COUNT; ++action)
 	{
-		nextCmd = cmds->at(0);
+		latencies[action].clear();
 	}
-	if (mem != nullptr)
+}
+
+int32_t CommandProcessor::getNextCmdIndex()
+{
+	if (nextCmdIndex < 0 || nextCmdIndex >= cmds->size())
 	{
-		mem->clear();
+		nextCmdIndex = (cmds->size() > 0 ? 0 : -1);
 	}
+	return nextCmdIndex;
 }
 
-int16_t CommandProcessor::getNextCmdIndex()
+QResultStatus CommandProcessor::seekTo(const uint32_t index)
 {
-	if (nextCmd == nullptr)
+	if (getCmdsCount() <= index)
+	{
+		return QResult_IndexOutOfRange;
+	}
+
+	bool isHistoryEnough = !history.isEmpty() && history.first().cmdIndex <= index;
+	if ((int32_t)index < getNextCmdIndex() && isHistoryEnough && nextCmdIndex - index <= CHECKPOINT_INTERVAL)
+	{
+		// short jumps are cheaper to revert than to replay from a checkpoint
+		while (!history.isEmpty() && history.last().cmdIndex >= index)
+		{
+			stepBack();
+		}
+	}
+	else if ((int32_t)index < getNextCmdIndex())
 	{
-		if (cmds->size())
+		// going back to the nearest checkpoint before the command
+		history.clear();
+		QMap<uint32_t, Checkpoint>::const_iterator checkpoint = checkpoints.upperBound(index);
+		if (checkpoint == checkpoints.constBegin())
 		{
-			nextCmd = cmds->at(0);
+			rewind();
 		}
 		else
 		{
-			return -1;
+			--checkpoint;
+			if (mem->loadState(checkpoint.value().state) != QResult_Success ||
+					slabs->loadState(checkpoint.value().slabsState) != QResult_Success)
+			{
+				rewind();
+			}
+			else
+			{
+				analytics->truncate(checkpoint.value().analyticsSteps);
+				nextCmdIndex = checkpoint.key();
+			}
 		}
 	}
-	for (uint16_t index = 0; index < cmds->size(); ++index)
+
+	// replaying until the command, failed commands are skipped
+	QString result;
+	while (nextCmdIndex != (int32_t)index)
 	{
-		if (cmds->at(index) == nextCmd)
+		result.clear();
+		if (execNextCmd(&result) != QResult_Success)
 		{
-			return index;
+			skipNextCmd();
 		}
 	}
-	return -1;
+	return QResult_Success;
+}
+
+QResultStatus CommandProcessor::stepBack()
+{
+	if (history.isEmpty())
+	{
+		return QResult_ActionUnavailable;
+	}
+
+	ExecutedCmd executedCmd = history.takeLast();
+	mem->undoTo(executedCmd.undoOpsCount);
+	slabs->undoTo(executedCmd.slabUndoOpsCount);
+	analytics->truncate(executedCmd.analyticsSteps);
+	nextCmdIndex = executedCmd.cmdIndex;
+	return QResult_Success;
+}
+
+void CommandProcessor::setUndoEnabled(bool value)
+{
+	isUndoEnabled = value;
+	history.clear();
+	mem->setUndoEnabled(value);
+	slabs->setUndoEnabled(value);
+}
+
+void CommandProcessor::rewind()
+{
+	nextCmdIndex = (cmds->size() > 0 ? 0 : -1);
+	if (mem != nullptr)
+	{
+		mem->clear();
+		slabs->clear();
+	}
+	analytics->clear();
+	checkpoints.clear();
+	history.clear();
+}
+
+void CommandProcessor::invalidateCheckpoints(const uint32_t index)
+{
+	// states saved after the command include its result
+	QMap<uint32_t, Checkpoint>::iterator checkpoint = checkpoints.upperBound(index);
+	while (checkpoint != checkpoints.end())
+	{
+		checkpoint = checkpoints.erase(checkpoint);
+	}
 }
 
 QResultStatus CommandProcessor::toSvg(const QString& pathToFile)
@@ -236,32 +468,82 @@ QChartView* CommandProcessor::toChart()
 	return mem->toChart();
 }
 
+Memory* CommandProcessor::getMemory()
+{
+	return mem;
+}
+
+SlabAllocator* CommandProcessor::getSlabs()
+{
+	return slabs;
+}
+
+void CommandProcessor::setAnalyticsEnabled(bool value)
+{
+	isAnalyticsEnabled = value;
+}
+
+MemoryAnalytics* CommandProcessor::getAnalytics()
+{
+	return analytics;
+}
+
+QResultStatus CommandProcessor::analyticsToCsv(const QString& pathToFile)
+{
+	return analytics->toCsv(pathToFile, names);
+}
+
+const LatencyHistogram& CommandProcessor::getLatency(const CommandAction action) const
+{
+	return latencies.at(action);
+}
+
 void CommandProcessor::queryInfo()
 {
 	mem->recalculateInfo();
+	MemoryInfo::allocateLatency = latencies.at(CommandAction::Allocate).toString();
+	MemoryInfo::freeLatency = latencies.at(CommandAction::Free).toString();
+	MemoryInfo::queryLatency = latencies.at(CommandAction::Query).toString();
+}
+
+QResultStatus CommandProcessor::checkInvariants(QString* violation) const
+{
+	QResultStatus resultStatus = mem->checkInvariants(violation);
+	if (resultStatus == QResult_Success)
+	{
+		resultStatus = slabs->checkInvariants(violation);
+	}
+	return resultStatus;
 }
 
 QString Command::cmdToStr()
 {
-	QString result = "";
+	char symbol = actionToChar(action);
+	if (symbol == 0)
+	{
+		return "";
+	}
+
+	return QString("%1 %2 %3").arg(QString(QChar(symbol)), blockName, QString::number(blockSize));
+}
 
+char Command::actionToChar(const CommandAction action)
+{
 	switch (action)
 	{
 		case CommandAction::Allocate:
-			result.append("+");
-			break;
+			return '+';
 		case CommandAction::Free:
-			result.append("-");
-			break;
+			return '-';
 		case CommandAction::Query:
-			result.append("?");
-			break;
+			return '?';
+		case CommandAction::CacheAllocate:
+			return '>';
+		case CommandAction::CacheFree:
+			return '<';
 		default:
-			return "";
+			return 0;
 	}
-	result = QString("%1 %2 %3").arg(result, blockName, QString::number(blockSize));
-
-	return result;
 }
 
 QResultStatus Command::strToCmd(QString& str)
@@ -283,6 +565,14 @@ QResultStatus Command::strToCmd(QString& str)
 		{
 			action = CommandAction::Query;
 		}
+		else if (subStrings.at(0) == ">")
+		{
+			action = CommandAction::CacheAllocate;
+		}
+		else if (subStrings.at(0) == "<")
+		{
+			action = CommandAction::CacheFree;
+		}
 		else throw QResult_IncorrectData;
 
 		blockName = subStrings.at(1);
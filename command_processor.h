@@ -3,6 +3,8 @@
 
 #include <QtCore/qglobal.h>
 #include <QVector>
+#include <QMap>
+#include <QByteArray>
 #include <QtCharts/QChartView>
 #include <QRegularExpression>
 #include <QStringList>
@@ -13,13 +15,24 @@ QT_CHARTS_USE_NAMESPACE
 #include "memory.h"
 #include "memory_settings.h"
 #include "memory_info.h"
+#include "name_table.h"
+#include "memory_analytics.h"
+#include "slab_allocator.h"
+#include "latency_histogram.h"
+
+/// Commands executed between two saved states of memory.
+const uint16_t CHECKPOINT_INTERVAL = 1024;
 
 enum CommandAction
 {
 	Allocate,
 	Free,
-	Query
+	Query,
+	/// Allocation of an object named "cache:object" from a slab cache.
+	CacheAllocate,
+	CacheFree
 };
+const uint8_t COMMAND_ACTIONS_COUNT = 5;
 
 class Command
 {
@@ -28,14 +41,18 @@ class Command
 		{
 			action = Free;
 			blockName = "";
+			blockId = NameTable::NO_NAME;
 			blockSize = 0;
+			blockDegree = 0;
 		}
 
 		Command(const Command* cmd) : Command()
 		{
 			this->action = cmd->action;
 			this->blockName = cmd->blockName;
+			this->blockId = cmd->blockId;
 			this->blockSize = cmd->blockSize;
+			this->blockDegree = cmd->blockDegree;
 		}
 		~Command() { }
 
@@ -43,15 +60,22 @@ class Command
 		{
 			this->action = action;
 			this->blockName = blockName;
+			this->blockId = NameTable::NO_NAME;
 			this-> blockSize = blockSize;
+			this->blockDegree = 0;
 		}
 
 		CommandAction action;
 		QString blockName;
+		/// Interned blockName, assigned by CommandProcessor::addCmd().
+		uint32_t blockId;
 		uint64_t blockSize;
+		/// Degree which holds blockSize, assigned by CommandProcessor::addCmd().
+		uint8_t blockDegree;
 
 		QString cmdToStr();
 		QResultStatus strToCmd(QString& str);
+		static char actionToChar(const CommandAction action);
 };
 
 class CommandProcessor
@@ -61,26 +85,76 @@ class CommandProcessor
 		~CommandProcessor();
 
 		void addCmd(Command* cmd);
-		Command* getCmd(const uint16_t index);
+		/// Adds a trace at once, degrees of its sizes are computed in one batch.
+		void addCmds(const QVector<Command*>& newCmds);
+		Command* getCmd(const uint32_t index);
 		QVector<Command*>* getAllCmds();
-		QResultStatus removeCmd(const uint16_t index);
+		QResultStatus removeCmd(const uint32_t index);
 		void removeAllCmds();
-		uint16_t getCmdsCount() const;
+		uint32_t getCmdsCount() const;
 		QString getRandomName() const;
 
 		QResultStatus execNextCmd(QString* result = nullptr);
+		void skipNextCmd();
 		void resetExec();
-		int16_t getNextCmdIndex();
+		int32_t getNextCmdIndex();
+		QResultStatus seekTo(const uint32_t index);
+		QResultStatus stepBack();
+		void setUndoEnabled(bool value);
 
 		QResultStatus toSvg(const QString& pathToFile);
 		QChartView* toChart();
+		Memory* getMemory();
+		SlabAllocator* getSlabs();
+		/// Steps are kept for every executed command, off by default.
+		void setAnalyticsEnabled(bool value);
+		MemoryAnalytics* getAnalytics();
+		QResultStatus analyticsToCsv(const QString& pathToFile);
+		/// Durations of commands of the action executed since the last reset, sampled by command index.
+		/// Commands replayed by seeking or stepping back are counted once a pass.
+		const LatencyHistogram& getLatency(const CommandAction action) const;
 
 		void queryInfo();
+		/// Verifies memory and slab caches, the first violation is described.
+		QResultStatus checkInvariants(QString* violation = nullptr) const;
 
 	private:
+		/// State of memory before some command of the current pass.
+		struct Checkpoint
+		{
+			QByteArray state;
+			QByteArray slabsState;
+			uint32_t analyticsSteps;
+		};
+
+		/// Executed command which can be reverted through the undo log of memory.
+		struct ExecutedCmd
+		{
+			uint32_t cmdIndex;
+			uint32_t undoOpsCount;
+			uint32_t slabUndoOpsCount;
+			uint32_t analyticsSteps;
+		};
+
 		QVector<Command*>* cmds;
+		NameTable* names;
 		Memory *mem;
-		Command* nextCmd;
+		SlabAllocator* slabs;
+		MemoryAnalytics* analytics;
+		bool isAnalyticsEnabled;
+		QVector<LatencyHistogram> latencies;
+		/// Commands from the beginning of the pass whose durations are recorded, running them again records nothing.
+		int32_t timedCmdsCount;
+		int32_t nextCmdIndex;
+		/// Checkpoints of the current pass by command index.
+		QMap<uint32_t, Checkpoint> checkpoints;
+		/// Commands executed in the current pass since the last checkpoint restore.
+		QVector<ExecutedCmd> history;
+		bool isUndoEnabled;
+
+		/// Returns to the beginning of the pass, the latencies are kept.
+		void rewind();
+		void invalidateCheckpoints(const uint32_t index);
 };
 
 #endif // COMMAND_PROCESSOR_H
@@ -0,0 +1,127 @@
+#include "commands_model.h"
+
+CommandsModel::CommandsModel(CommandProcessor* processor, QObject *parent) :
+	QAbstractTableModel(parent),
+	processor(processor)
+{
+
+}
+
+void CommandsModel::setProcessor(CommandProcessor* processor)
+{
+	beginResetModel();
+	this->processor = processor;
+	endResetModel();
+}
+
+void CommandsModel::addCmd(Command* cmd)
+{
+	int row = processor->getCmdsCount();
+	beginInsertRows(QModelIndex(), row, row);
+	processor->addCmd(cmd);
+	endInsertRows();
+}
+
+QResultStatus CommandsModel::removeCmd(const uint32_t index)
+{
+	if (processor->getCmdsCount() <= index)
+	{
+		return QResult_IndexOutOfRange;
+	}
+
+	beginRemoveRows(QModelIndex(), index, index);
+	QResultStatus resultStatus = processor->removeCmd(index);
+	endRemoveRows();
+	return resultStatus;
+}
+
+int CommandsModel::rowCount(const QModelIndex &parent) const
+{
+	if (parent.isValid() || processor == nullptr)
+	{
+		return 0;
+	}
+	return processor->getCmdsCount();
+}
+
+int CommandsModel::columnCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : 3;
+}
+
+QVariant CommandsModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid())
+	{
+		return QVariant();
+	}
+
+	if (role == Qt::TextAlignmentRole)
+	{
+		return int(Qt::AlignCenter);
+	}
+	if (role != Qt::DisplayRole)
+	{
+		return QVariant();
+	}
+
+	Command* cmd = processor->getCmd(index.row());
+	if (cmd == nullptr)
+	{
+		return QVariant();
+	}
+
+	switch (index.column())
+	{
+		case 0:
+			switch (cmd->action)
+			{
+				case CommandAction::Allocate:
+					return QString("+");
+				case CommandAction::Free:
+					return QString("-");
+				case CommandAction::Query:
+					return QString("?");
+				case CommandAction::CacheAllocate:
+					return QString(">");
+				case CommandAction::CacheFree:
+					return QString("<");
+				default:
+					return QVariant();
+			}
+		case 1:
+			return cmd->blockName;
+		case 2:
+			if (cmd->blockSize != 0)
+			{
+				return MemorySettings::bytesToString(cmd->blockSize);
+			}
+			return QString("");
+		default:
+			return QVariant();
+	}
+}
+
+QVariant CommandsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (role != Qt::DisplayRole)
+	{
+		return QVariant();
+	}
+
+	if (orientation == Qt::Horizontal)
+	{
+		switch (section)
+		{
+			case 0:
+				return QString("Action");
+			case 1:
+				return QString("Process Name");
+			case 2:
+				return QString("Block size");
+			default:
+				return QVariant();
+		}
+	}
+	return QString("%1").arg(section + 1);
+}
@@ -0,0 +1,32 @@
+#ifndef COMMANDS_MODEL_H
+#define COMMANDS_MODEL_H
+
+#include <QtCore/qglobal.h>
+#include <QAbstractTableModel>
+
+#include "common.h"
+#include "command_processor.h"
+
+/// Table model over the commands stored in CommandProcessor.
+/// Rows are produced on demand by the view, so only visible rows are materialized.
+class CommandsModel : public QAbstractTableModel
+{
+		Q_OBJECT
+
+	public:
+		explicit CommandsModel(CommandProcessor* processor, QObject *parent = 0);
+
+		void setProcessor(CommandProcessor* processor);
+		void addCmd(Command* cmd);
+		QResultStatus removeCmd(const uint32_t index);
+
+		int rowCount(const QModelIndex &parent = QModelIndex()) const;
+		int columnCount(const QModelIndex &parent = QModelIndex()) const;
+		QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+		QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+
+	private:
+		CommandProcessor* processor;
+};
+
+#endif // COMMANDS_MODEL_H
@@ -0,0 +1,43 @@
+# Simulator core shared by the application and the command line tools.
+
+INCLUDEPATH += $$PWD
+
+# trace points of the hot paths, enabled by "qmake CONFIG+=tracing"
+tracing {
+    DEFINES += MEMORY_TRACING
+}
+
+SOURCES += \
+    $$PWD/memory_settings.cpp \
+    $$PWD/command_processor.cpp \
+    $$PWD/memory.cpp \
+    $$PWD/block.cpp \
+    $$PWD/free_bitmap.cpp \
+    $$PWD/backing_store.cpp \
+    $$PWD/slab_allocator.cpp \
+    $$PWD/memory_info.cpp \
+    $$PWD/name_table.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/memory_analytics.cpp \
+    $$PWD/latency_histogram.cpp \
+    $$PWD/workload_generator.cpp \
+    $$PWD/zone_allocator.cpp
+
+HEADERS += \
+    $$PWD/common.h \
+    $$PWD/memory_settings.h \
+    $$PWD/command_processor.h \
+    $$PWD/memory.h \
+    $$PWD/fixed_memory.h \
+    $$PWD/block.h \
+    $$PWD/free_bitmap.h \
+    $$PWD/backing_store.h \
+    $$PWD/slab_allocator.h \
+    $$PWD/state_buffer.h \
+    $$PWD/memory_info.h \
+    $$PWD/name_table.h \
+    $$PWD/trace.h \
+    $$PWD/memory_analytics.h \
+    $$PWD/latency_histogram.h \
+    $$PWD/workload_generator.h \
+    $$PWD/zone_allocator.h
@@ -6,21 +6,37 @@ DialogSettings::DialogSettings(QWidget *parent) :
 	ui(new Ui::DialogSettings),
 	memorySettings(new MemorySettings()),
 	processor(new CommandProcessor(memorySettings)),
+	cmdsModel(new CommandsModel(processor, this)),
 	execTimer(new QTimer()),
 	saveTimer(new QTimer()),
-	updateInProgress(false)
+	updateInProgress(false),
+	savedCmdsCount(0),
+	savedFileSize(0),
+	cmdsRewriteNeeded(false)
 {
 	ui->setupUi(this);
 
+	ui->cmds->setModel(cmdsModel);
+	ui->cmds->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+	ui->cmds->verticalHeader()->setDefaultSectionSize(25);
+
 	hotkeyDeleteCmd = new QShortcut(QKeySequence("Del"), this);
 	connect(hotkeyDeleteCmd, SIGNAL(activated()), this, SLOT(on_deleteCmd()));
 	connect(execTimer, SIGNAL(timeout()), this, SLOT(on_execNextCmd_clicked()));
+	saveTimer->setSingleShot(true);
+	connect(saveTimer, SIGNAL(timeout()), this, SLOT(flushCmdsToFile()));
 
 	updateSettingsFromObject();
 }
 
 DialogSettings::~DialogSettings()
 {
+	// writing edits that are still waiting for the timer
+	if (saveTimer->isActive())
+	{
+		saveTimer->stop();
+		flushCmdsToFile();
+	}
 	delete ui;
 	delete memorySettings;
 }
@@ -66,6 +82,15 @@ void DialogSettings::updateSettingsFromObject()
 	ui->stepsExecSpeedSpinBox->setValue(memorySettings->getStepsExecutionSpeed());
 
 	ui->autoSave->setChecked(memorySettings->getAutoSaveCmds());
+	ui->autoSaveMode->setCurrentIndex(memorySettings->getAutoSaveMode());
+	ui->placementPolicy->setCurrentIndex(memorySettings->getPlacementPolicy());
+	ui->coalescingMode->setCurrentIndex(memorySettings->getCoalescingMode());
+	ui->coalescingWatermark->setMinimum(1);
+	ui->coalescingWatermark->setMaximum(int(memorySettings->MAX_COALESCING_WATERMARK));
+	ui->coalescingWatermark->setValue(int(memorySettings->getCoalescingWatermark()));
+	ui->coalescingWatermark->setEnabled(memorySettings->getCoalescingMode() == CoalescingMode::LazyCoalescing);
+	ui->tailTrimming->setChecked(memorySettings->getTailTrimming());
+	ui->hugePageClustering->setChecked(memorySettings->getHugePageClustering());
 
 	updateLabels();
 
@@ -85,102 +110,114 @@ void DialogSettings::updateLabels()
 
 void DialogSettings::updateCmdsTable()
 {
-	ui->cmds->clear();
-	uint16_t cmdsCount = processor->getCmdsCount();
-
-	QStringList colHeaders, rowHeaders;
-	ui->cmds->setColumnCount(3);
-	ui->cmds->setRowCount(cmdsCount);
+	highlightNextCommand();
 
-	colHeaders << "Action" << "Process Name" << "Block size";
-	for (uint16_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
+	// manage autosave
+	if (memorySettings->getAutoSaveCmds())
 	{
-		ui->cmds->setRowHeight(cmdIndex, 25);
-		rowHeaders << QString("%1").arg(cmdIndex + 1);
+		scheduleCmdsSave();
 	}
-	ui->cmds->setHorizontalHeaderLabels(colHeaders);
-	ui->cmds->setVerticalHeaderLabels(rowHeaders);
+}
 
-	for (uint16_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
+void DialogSettings::highlightNextCommand()
+{
+	ui->cmds->clearSelection();
+	int32_t index = processor->getNextCmdIndex();
+	if (index >= 0)
 	{
-		Command* cmd = processor->getCmd(cmdIndex);
-		QTableWidgetItem* item;
-		switch (cmd->action)
-		{
-			case CommandAction::Allocate:
-				item = new QTableWidgetItem("+");
-				item->setTextAlignment(Qt::AlignCenter);
-				ui->cmds->setItem(cmdIndex, 0, item);
-				break;
-			case CommandAction::Free:
-				item = new QTableWidgetItem("-");
-				item->setTextAlignment(Qt::AlignCenter);
-				ui->cmds->setItem(cmdIndex, 0, item);
-				break;
-			case CommandAction::Query:
-				item = new QTableWidgetItem("?");
-				item->setTextAlignment(Qt::AlignCenter);
-				ui->cmds->setItem(cmdIndex, 0, item);
-				break;
-		}
-		item = new QTableWidgetItem(cmd->blockName);
-		item->setTextAlignment(Qt::AlignCenter);
-		ui->cmds->setItem(cmdIndex, 1, item);
-		if (cmd->blockSize != 0)
-		{
-			item = new QTableWidgetItem(MemorySettings::bytesToString(cmd->blockSize));
-			item->setTextAlignment(Qt::AlignCenter);
-			ui->cmds->setItem(cmdIndex, 2, item);
-		}
-		else
-		{
-			ui->cmds->setItem(cmdIndex, 2, new QTableWidgetItem(""));
-		}
+		ui->cmds->selectRow(index);
+	}
 
-		item->setTextAlignment(Qt::AlignCenter);
-		ui->cmds->setItem(cmdIndex, 0, item);
+	// moving the timeline without seeking again
+	ui->timeline->blockSignals(true);
+	ui->timeline->setMaximum(qMax<int32_t>(0, processor->getCmdsCount() - 1));
+	ui->timeline->setValue(qMax<int32_t>(0, index));
+	ui->timeline->blockSignals(false);
+}
+
+void DialogSettings::scheduleCmdsSave()
+{
+	if (cmdFilePath == "") return;
+
+	if (memorySettings->getAutoSaveMode() == AutoSaveMode::Immediate)
+	{
+		flushCmdsToFile();
+	}
+	else
+	{
+		// restarting the timer coalesces edits made in a row
+		saveTimer->start(memorySettings->AUTO_SAVE_DELAY);
 	}
+}
 
-	highlightNextCommand();
+void DialogSettings::flushCmdsToFile()
+{
+	if (cmdFilePath == "") return;
 
-	// manage autosave
-	if (memorySettings->getAutoSaveCmds())
+	uint32_t cmdsCount = processor->getCmdsCount();
+	bool isFileUntouched = QFileInfo(cmdFilePath).size() == savedFileSize;
+
+	if (cmdsRewriteNeeded || !isFileUntouched || cmdsCount < savedCmdsCount)
 	{
 		saveCmdsToFile();
 	}
+	else if (cmdsCount > savedCmdsCount)
+	{
+		// only new commands were added, so the file tail is enough
+		if (!appendCmdsToFile())
+		{
+			saveCmdsToFile();
+		}
+	}
 }
 
-void DialogSettings::highlightNextCommand()
+bool DialogSettings::appendCmdsToFile()
 {
-	ui->cmds->clearSelection();
-	int16_t index = processor->getNextCmdIndex();
-	if (index >= 0)
+	QFile file(cmdFilePath);
+	if (!file.open(QFile::WriteOnly | QFile::Append | QFile::Text)) {
+		return false;
+	}
+	QTextStream wfstream(&file);
+	uint32_t cmdsCount = processor->getCmdsCount();
+	for (uint32_t cmdIndex = savedCmdsCount; cmdIndex < cmdsCount; ++cmdIndex)
 	{
-		ui->cmds->selectRow(index);
+		wfstream << processor->getCmd(cmdIndex)->cmdToStr() << '\n';
 	}
+	wfstream.flush();
+	file.flush();
+	file.close();
+
+	savedCmdsCount = cmdsCount;
+	savedFileSize = QFileInfo(cmdFilePath).size();
+	printMessage(QString("Commands appended to %1.").arg(cmdFilePath), MessageStatus::Info);
+	return true;
 }
 
 void DialogSettings::saveCmdsToFile()
 {
 	if (cmdFilePath == "") return;
-	// trying to open file
-	QFile file(cmdFilePath);
+	// writing to a temporary file which replaces the target on commit
+	QSaveFile file(cmdFilePath);
 	if (!file.open(QFile::WriteOnly | QFile::Text)) {
 		printMessage("Cannot open file for writing", MessageStatus::Error);
 		return;
 	}
 	// writing cmds to file
 	QTextStream wfstream(&file);
-	QVector<Command*>* cmds = processor->getAllCmds();
-	foreach (Command* cmd, *cmds)
+	uint32_t cmdsCount = processor->getCmdsCount();
+	for (uint32_t cmdIndex = 0; cmdIndex < cmdsCount; ++cmdIndex)
 	{
-		wfstream << cmd->cmdToStr() << '\n';
+		wfstream << processor->getCmd(cmdIndex)->cmdToStr() << '\n';
 	}
-	delete cmds;
 	wfstream.flush();
-	// closing file
-	file.flush();
-	file.close();
+	if (!file.commit()) {
+		printMessage("Cannot write file with commands", MessageStatus::Error);
+		return;
+	}
+
+	savedCmdsCount = cmdsCount;
+	savedFileSize = QFileInfo(cmdFilePath).size();
+	cmdsRewriteNeeded = false;
 	printMessage(QString("Commands saved to %1.").arg(cmdFilePath), MessageStatus::Info);
 }
 
@@ -192,10 +229,10 @@ void DialogSettings::resetProcessor()
 	QVector<Command*>* cmds = processor->getAllCmds();
 	delete processor;
 	processor = new CommandProcessor(memorySettings);
-	foreach (Command* cmd, *cmds)
-	{
-		processor->addCmd(cmd);
-	}
+	processor->setAnalyticsEnabled(ui->recordAnalytics->isChecked());
+	processor->addCmds(*cmds);
+	delete cmds;
+	cmdsModel->setProcessor(processor);
 }
 
 void DialogSettings::printMessage(const QString& string, const MessageStatus& status)
@@ -346,23 +383,50 @@ void DialogSettings::on_exportLog_clicked()
 	file.close();
 }
 
+void DialogSettings::on_exportAnalytics_clicked()
+{
+	QDateTime dateTime = QDateTime::currentDateTime();
+	QString timestamp = dateTime.toString("yyyy-MM-dd HH:mm:ss");
+	QString fileName = QFileDialog::getSaveFileName(this,
+								 "Choose file for writing analytics",
+								 QString("Analytics %1.csv").arg(timestamp),
+								 "CSV files (*.csv) ;; All files (*.*)");
+	if (fileName == "") return;
+
+	if (processor->analyticsToCsv(fileName) != QResult_Success)
+	{
+		printMessage("Cannot open file for writing", MessageStatus::Error);
+		return;
+	}
+	printMessage(QString("Analytics of %1 steps saved to %2.").arg(
+					 QString::number(processor->getAnalytics()->getStepsCount()), fileName), MessageStatus::Info);
+}
+
+void DialogSettings::on_recordAnalytics_clicked()
+{
+	// steps are kept for every executed command, so only while the export is wanted
+	processor->setAnalyticsEnabled(ui->recordAnalytics->isChecked());
+	ui->exportAnalytics->setEnabled(ui->recordAnalytics->isChecked());
+}
+
 void DialogSettings::on_deleteCmd()
 {
 	QItemSelectionModel* select = ui->cmds->selectionModel();
 	if (!select->hasSelection()) return;
-	QModelIndexList selectedIndexes = select->selectedIndexes();
+	QModelIndexList selectedRows = select->selectedRows();
 
-	QSet<uint16_t> indexesToDelete;
-
-	foreach (QModelIndex index, selectedIndexes)
+	QList<uint32_t> indexesToDelete;
+	foreach (QModelIndex index, selectedRows)
 	{
-		indexesToDelete.insert(index.row());
+		indexesToDelete.push_back(index.row());
 	}
-	QSet<uint16_t>::reverse_iterator iter;
-	for (iter = indexesToDelete.rbegin(); iter != indexesToDelete.rend(); ++iter)
+	// removing from the end so the remaining indexes stay valid
+	std::sort(indexesToDelete.begin(), indexesToDelete.end(), std::greater<uint32_t>());
+	foreach (uint32_t index, indexesToDelete)
 	{
-		processor->removeCmd(*iter);
+		cmdsModel->removeCmd(index);
 	}
+	cmdsRewriteNeeded = true;
 	updateCmdsTable();
 }
 
@@ -419,9 +483,35 @@ void DialogSettings::on_resetExec_clicked()
 	updateCmdsTable();
 }
 
+void DialogSettings::on_stepBack_clicked()
+{
+	if (processor->stepBack() != QResult_Success)
+	{
+		printMessage("No executed commands to revert.", MessageStatus::Error);
+		return;
+	}
+	lastCmdError = false;
+	emit redraw();
+	highlightNextCommand();
+}
+
+void DialogSettings::on_timeline_valueChanged(int value)
+{
+	if (execTimer->isActive())
+	{
+		execTimer->stop();
+		ui->autoExec->setText("Automatic execution");
+	}
+	if (processor->seekTo(value) != QResult_Success) return;
+
+	lastCmdError = false;
+	emit redraw();
+	highlightNextCommand();
+}
+
 void DialogSettings::on_cmdOperation_currentIndexChanged(const QString &string)
 {
-	if (string != "Allocate")
+	if (string != "Allocate" && string != "Cache allocate")
 	{
 		ui->blockSize->setEnabled(false);
 		ui->blockSizeUnits->setEnabled(false);
@@ -448,17 +538,32 @@ void DialogSettings::on_addCmd_clicked()
 	{
 		cmd->action	= CommandAction::Query;
 	}
+	else if (ui->cmdOperation->currentText() == "Cache allocate")
+	{
+		cmd->action	= CommandAction::CacheAllocate;
+	}
+	else if (ui->cmdOperation->currentText() == "Cache free")
+	{
+		cmd->action	= CommandAction::CacheFree;
+	}
 	// settings name
 	if (ui->cmdBlockName->text().length() == 0)
 	{
 		cmd->blockName = processor->getRandomName();
 	}
+	else if (ui->cmdBlockName->text().contains(QRegularExpression("\\s")))
+	{
+		// such names cannot be saved to a command file, slab pages are named so
+		printMessage("Block names cannot contain spaces.", MessageStatus::Error);
+		delete cmd;
+		return;
+	}
 	else
 	{
 		cmd->blockName = ui->cmdBlockName->text();
 	}
 
-	if (cmd->action == CommandAction::Allocate)
+	if (cmd->action == CommandAction::Allocate || cmd->action == CommandAction::CacheAllocate)
 	{
 		cmd->blockSize = (uint64_t)ui->blockSize->value();
 	}
@@ -478,7 +583,7 @@ void DialogSettings::on_addCmd_clicked()
 	}
 	cmd->blockSize *= multiplier;
 
-	processor->addCmd(cmd);
+	cmdsModel->addCmd(cmd);
 
 	updateCmdsTable();
 }
@@ -509,6 +614,57 @@ void DialogSettings::on_drawingTool_currentIndexChanged(const QString &str)
 	else if (str == "circo") memorySettings->setDrawUtility(DrawUtility::circo);
 }
 
+void DialogSettings::on_autoSaveMode_currentIndexChanged(const QString &str)
+{
+	if (updateInProgress) return;
+
+	if (str == "Immediate") memorySettings->setAutoSaveMode(AutoSaveMode::Immediate);
+	else memorySettings->setAutoSaveMode(AutoSaveMode::Debounced);
+}
+
+void DialogSettings::on_placementPolicy_currentIndexChanged(int index)
+{
+	if (updateInProgress) return;
+
+	// blocks placed by another policy would not be indexed
+	memorySettings->setPlacementPolicy(PlacementPolicy(index));
+	updateSettingsFromObject();
+}
+
+void DialogSettings::on_coalescingMode_currentIndexChanged(int index)
+{
+	if (updateInProgress) return;
+
+	memorySettings->setCoalescingMode(CoalescingMode(index));
+	updateSettingsFromObject();
+}
+
+void DialogSettings::on_coalescingWatermark_valueChanged(int value)
+{
+	if (updateInProgress) return;
+
+	if (memorySettings->setCoalescingWatermark(uint32_t(value)) == QResult_Success)
+	{
+		updateSettingsFromObject();
+	}
+}
+
+void DialogSettings::on_tailTrimming_clicked()
+{
+	if (updateInProgress) return;
+
+	memorySettings->setTailTrimming(ui->tailTrimming->isChecked());
+	updateSettingsFromObject();
+}
+
+void DialogSettings::on_hugePageClustering_clicked()
+{
+	if (updateInProgress) return;
+
+	memorySettings->setHugePageClustering(ui->hugePageClustering->isChecked());
+	updateSettingsFromObject();
+}
+
 void DialogSettings::on_stepsExecSpeedSlider_sliderMoved(int position)
 {
 	if (updateInProgress) return;
@@ -533,6 +689,7 @@ void DialogSettings::on_saveCmds_clicked()
 								 "Command files (*.cmds) ;; Text files (*.txt) ;; All files (*.*)");
 	if (fileName != "")
 	{
+		saveTimer->stop();
 		cmdFilePath = fileName;
 		saveCmdsToFile();
 	}
@@ -545,6 +702,7 @@ void DialogSettings::on_loadCmds_clicked()
 				"Choose file with commands",
 				QDir::currentPath(),
 				QString("Command file (*.cmds);;Text files (*.txt);;All files (*.*)"));
+	saveTimer->stop();
 	this->cmdFilePath = fileName;
 	// trying to open file
 	QFile file(fileName);
@@ -554,8 +712,11 @@ void DialogSettings::on_loadCmds_clicked()
 	}
 	// read and validate table
 	CommandProcessor* newProcessor = new CommandProcessor(memorySettings);
+	newProcessor->setAnalyticsEnabled(ui->recordAnalytics->isChecked());
 
+	bool hasInvalidLines = false;
 	QTextStream stream(&file);
+	QVector<Command*> cmds;
 	while (!stream.atEnd())
 	{
 		QString line = stream.readLine();
@@ -565,21 +726,35 @@ void DialogSettings::on_loadCmds_clicked()
 		{
 			printMessage(QString("Error in line: '%1'.").arg(line), MessageStatus::Error);
 			delete cmd;
+			hasInvalidLines = true;
 			continue;
 		}
-		newProcessor->addCmd(cmd);
+		cmds.push_back(cmd);
 	}
+	newProcessor->addCmds(cmds);
 	// check success
 	if (newProcessor->getCmdsCount() == 0)
 	{
 		printMessage(QString("No valid commands found in file."), MessageStatus::Error);
 		delete newProcessor;
+		cmdsRewriteNeeded = true;
 	}
 	else
 	{
 		delete processor;
 		processor = newProcessor;
+		cmdsModel->setProcessor(processor);
 		printMessage(QString("Found %1 valid commands.").arg(processor->getCmdsCount()), MessageStatus::Info);
+		// the file already holds these commands unless some lines were dropped,
+		// a last line without a newline would run into the first appended command
+		char lastChar = '\n';
+		if (file.size() > 0 && file.seek(file.size() - 1))
+		{
+			file.getChar(&lastChar);
+		}
+		savedCmdsCount = processor->getCmdsCount();
+		savedFileSize = file.size();
+		cmdsRewriteNeeded = hasInvalidLines || lastChar != '\n';
 	}
 
 	updateCmdsTable();
@@ -587,14 +762,14 @@ void DialogSettings::on_loadCmds_clicked()
 
 void DialogSettings::on_execAll_clicked()
 {
-	int16_t curCmdIndex = processor->getNextCmdIndex();
+	int32_t curCmdIndex = processor->getNextCmdIndex();
 	if (curCmdIndex >= 0)
 	{
 		curCmdIndex = curCmdIndex == 0 ? curCmdIndex : curCmdIndex -1;
 		execTimer->stop();
 		ui->autoExec->setText("Automatic execution");
 		lastCmdError = false;
-		for (int16_t next = curCmdIndex; next < processor->getCmdsCount(); ++next)
+		for (int32_t next = curCmdIndex; next < (int32_t)processor->getCmdsCount(); ++next)
 		{
 			on_execNextCmd_clicked();
 			if (lastCmdError) break;
@@ -5,19 +5,24 @@
 #include <QDebug>
 #include <QDateTime>
 #include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
 #include <QFileDialog>
 #include <QShortcut>
 #include <QList>
-#include <QTableWidget>
-#include <QTableWidgetItem>
+#include <QTableView>
+#include <QHeaderView>
 #include <QDateTime>
 #include <QTimer>
 #include <QtCharts/QChartView>
+#include <algorithm>
+#include <functional>
 
 QT_CHARTS_USE_NAMESPACE
 
 #include "memory_settings.h"
 #include "command_processor.h"
+#include "commands_model.h"
 
 namespace Ui {
 	class DialogSettings;
@@ -56,17 +61,26 @@ class DialogSettings : public QDialog
 		MemorySettings* memorySettings;
 		QShortcut* hotkeyDeleteCmd;
 		CommandProcessor* processor;
+		CommandsModel* cmdsModel;
 		QTimer* execTimer;
 		QTimer* saveTimer;
 		bool updateInProgress;
 		bool lastCmdError;
 		QString cmdFilePath;
+		/// Quantity of commands already written to cmdFilePath.
+		uint32_t savedCmdsCount;
+		/// Size of cmdFilePath after the last write, used to detect foreign changes.
+		qint64 savedFileSize;
+		/// Set when commands were removed since the last save, so appending is not enough.
+		bool cmdsRewriteNeeded;
 
 		void updateSettingsFromObject();
 		void updateLabels();	
 		void updateCmdsTable();
 		void highlightNextCommand();
 		void resetProcessor();
+		void scheduleCmdsSave();
+		bool appendCmdsToFile();
 
 	public slots:
 		void changeTab(DialogTab tab);
@@ -89,10 +103,14 @@ class DialogSettings : public QDialog
 		void on_restoreDefaultSettings_clicked();
 		void on_clearLog_clicked();
 		void on_exportLog_clicked();
+		void on_exportAnalytics_clicked();
+		void on_recordAnalytics_clicked();
 		void on_deleteCmd();
 		void on_autoExec_clicked();
 		void on_execNextCmd_clicked();
 		void on_resetExec_clicked();
+		void on_stepBack_clicked();
+		void on_timeline_valueChanged(int value);
 		void on_cmdOperation_currentIndexChanged(const QString &string);
 		void on_addCmd_clicked();
 		void on_autoSave_clicked();
@@ -102,6 +120,13 @@ class DialogSettings : public QDialog
 		void on_saveCmds_clicked();
 		void on_loadCmds_clicked();
 		void saveCmdsToFile();
+		void flushCmdsToFile();
+		void on_autoSaveMode_currentIndexChanged(const QString &str);
+		void on_placementPolicy_currentIndexChanged(int index);
+		void on_coalescingMode_currentIndexChanged(int index);
+		void on_coalescingWatermark_valueChanged(int value);
+		void on_tailTrimming_clicked();
+		void on_hugePageClustering_clicked();
 		void on_execAll_clicked();
 };
 
@@ -0,0 +1,22 @@
+#-------------------------------------------------
+#
+# Differential test of Memory against a reference model
+#
+#-------------------------------------------------
+
+QT       += core gui charts
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = CP_SSW_difftest
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+HEADERS += reference_memory.h
+SOURCES += main.cpp \
+    reference_memory.cpp
@@ -0,0 +1,278 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QTextStream>
+
+#include "memory.h"
+#include "fixed_memory.h"
+#include "command_processor.h"
+#include "reference_memory.h"
+
+static const char* POLICY_NAMES[] = { "first", "lowest", "highest", "best", "recent" };
+static const uint8_t POLICIES_COUNT = 5;
+
+/// First command after which the engine and the reference model disagree.
+struct Divergence
+{
+	int32_t cmdIndex;
+	QString engine;
+	QString reference;
+};
+
+static QResultStatus loadCmds(const QString& path, QVector<Command>* cmds)
+{
+	QFile file(path);
+	if (!file.open(QFile::ReadOnly | QFile::Text)) {
+		return QResult_NotFound;
+	}
+
+	QTextStream stream(&file);
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine();
+		Command cmd;
+		if (cmd.strToCmd(line) != QResult_Success) continue;
+		cmds->push_back(cmd);
+	}
+	return cmds->isEmpty() ? QResult_IncorrectData : QResult_Success;
+}
+
+static QString describe(const QResultStatus status, const uint64_t beginAddress, const uint64_t size,
+						const uint64_t freeBytes, const int16_t largestFreeDegree)
+{
+	QString text = QString("status %1, free %2, largest free degree %3").arg(status).arg(freeBytes).arg(largestFreeDegree);
+	if (beginAddress != UINT64_MAX)
+	{
+		text += QString(", block [%1; %2)").arg(beginAddress).arg(beginAddress + size);
+	}
+	return text;
+}
+
+/// Replays the commands against the engine and the reference model and stops at the first difference.
+/// Slab cache commands are not a part of Memory and are skipped.
+template <typename Engine>
+static bool diverges(Engine* engine, const QVector<const Command*>& cmds, MemorySettings* settings, Divergence* divergence)
+{
+	NameTable names;
+	Engine& mem = *engine;
+	mem.clear();
+	ReferenceMemory reference(settings);
+	for (int32_t cmdIndex = 0; cmdIndex < cmds.size(); ++cmdIndex)
+	{
+		const Command* cmd = cmds.at(cmdIndex);
+		uint32_t procId = names.intern(cmd->blockName);
+		QResultStatus memStatus = QResult_Success;
+		QResultStatus referenceStatus = QResult_Success;
+		switch (cmd->action)
+		{
+			case CommandAction::Allocate:
+				memStatus = mem.allocate(cmd->blockSize, procId);
+				referenceStatus = reference.allocate(cmd->blockSize, procId);
+				break;
+			case CommandAction::Free:
+				memStatus = mem.free(procId);
+				referenceStatus = reference.free(procId);
+				break;
+			case CommandAction::Query:
+				break;
+			default:
+				continue;
+		}
+
+		// the named block is compared after every command, the whole memory through its free space
+		QString memText = describe(memStatus, mem.getBeginAddress(procId), mem.getBlockSize(procId),
+								   mem.getFreeBytes(), mem.getLargestFreeDegree());
+		QString referenceText = describe(referenceStatus, reference.getBeginAddress(procId), reference.getBlockSize(procId),
+										 reference.getFreeBytes(), reference.getLargestFreeDegree());
+		if (memText != referenceText)
+		{
+			if (divergence != nullptr)
+			{
+				divergence->cmdIndex = cmdIndex;
+				divergence->engine = memText;
+				divergence->reference = referenceText;
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+/// Delta debugging: drops chunks of commands while the rest still diverges.
+template <typename Engine>
+static QVector<const Command*> minimize(Engine* engine, QVector<const Command*> cmds, MemorySettings* settings,
+										uint32_t* testsCount)
+{
+	uint32_t chunksCount = 2;
+	while (cmds.size() >= 2)
+	{
+		uint32_t chunkSize = (cmds.size() + chunksCount - 1) / chunksCount;
+		bool isReduced = false;
+		// a single chunk which diverges on its own, then everything but one chunk
+		for (uint8_t pass = 0; pass < 2 && !isReduced; ++pass)
+		{
+			for (uint32_t chunk = 0; chunk * chunkSize < (uint32_t)cmds.size() && !isReduced; ++chunk)
+			{
+				QVector<const Command*> candidate;
+				uint32_t begin = chunk * chunkSize;
+				uint32_t end = qMin<uint32_t>(begin + chunkSize, cmds.size());
+				if (pass == 0)
+				{
+					candidate = cmds.mid(begin, end - begin);
+				}
+				else
+				{
+					candidate = cmds.mid(0, begin);
+					candidate += cmds.mid(end);
+				}
+				if (candidate.isEmpty() || candidate.size() == cmds.size()) continue;
+
+				++*testsCount;
+				if (diverges(engine, candidate, settings, nullptr))
+				{
+					cmds = candidate;
+					chunksCount = (pass == 0 ? 2 : qMax<uint32_t>(chunksCount - 1, 2));
+					isReduced = true;
+				}
+			}
+		}
+		if (!isReduced)
+		{
+			if (chunksCount >= (uint32_t)cmds.size()) break;
+			chunksCount = qMin<uint32_t>(chunksCount * 2, cmds.size());
+		}
+	}
+	return cmds;
+}
+
+/// Reports the first divergence of the engine with its minimized trace, returns the exit code.
+template <typename Engine>
+static int compare(Engine* engine, const QVector<const Command*>& cmds, MemorySettings* settings,
+				   const QString& outPath, QTextStream& out)
+{
+	Divergence divergence;
+	if (!diverges(engine, cmds, settings, &divergence))
+	{
+		out << "Commands:      " << cmds.size() << ", no divergence\n";
+		return 0;
+	}
+
+	Command firstCmd(cmds.at(divergence.cmdIndex));
+	out << "Divergence at command " << divergence.cmdIndex << " \"" << firstCmd.cmdToStr() << "\"\n";
+	out << "  engine:      " << divergence.engine << "\n";
+	out << "  reference:   " << divergence.reference << "\n";
+
+	// commands after the divergence cannot matter
+	uint32_t testsCount = 0;
+	QVector<const Command*> minimized = minimize(engine, cmds.mid(0, divergence.cmdIndex + 1), settings, &testsCount);
+	out << "Minimized to " << minimized.size() << " commands in " << testsCount << " replays:\n";
+	QString trace;
+	foreach (const Command* cmd, minimized)
+	{
+		trace += Command(cmd).cmdToStr() + "\n";
+	}
+	out << trace;
+
+	if (!outPath.isEmpty())
+	{
+		QFile file(outPath);
+		if (!file.open(QFile::WriteOnly | QFile::Text)) {
+			out << "Cannot write the minimized trace to " << outPath << ".\n";
+			return 1;
+		}
+		QTextStream wfstream(&file);
+		wfstream << trace;
+		wfstream.flush();
+		file.close();
+	}
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream out(stdout);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Replays a command trace against Memory and a reference model and reports the first divergence.");
+	parser.addHelpOption();
+	parser.addPositionalArgument("cmds", "Command file to replay.");
+	parser.addOption(QCommandLineOption("total", "Total memory degree.", "degree", "24"));
+	parser.addOption(QCommandLineOption("min", "Min block degree.", "degree", "4"));
+	parser.addOption(QCommandLineOption("policy", "Placement policy: lowest, highest, best or recent.", "name", "lowest"));
+	parser.addOption(QCommandLineOption("trim", "Grant runs of blocks instead of rounding requests up to a power of two."));
+	parser.addOption(QCommandLineOption("out", "Write the minimized trace to a command file.", "file"));
+	parser.addOption(QCommandLineOption("engine", "Engine to test: memory, or fixed for the lowest address policy "
+												  "of memory 2^24 with blocks 2^4 or memory 2^16 with blocks 2^3.", "name", "memory"));
+	parser.process(app);
+
+	if (parser.positionalArguments().size() != 1)
+	{
+		parser.showHelp(1);
+	}
+
+	MemorySettings settings;
+	if (settings.setTotalMemoryDegree(parser.value("total").toUInt()) != QResult_Success ||
+			settings.setMinBlockDegree(parser.value("min").toUInt()) != QResult_Success)
+	{
+		out << "Memory degrees are out of range.\n";
+		return 1;
+	}
+	int16_t policy = -1;
+	for (uint8_t index = 0; index < POLICIES_COUNT; ++index)
+	{
+		if (parser.value("policy") == POLICY_NAMES[index]) policy = index;
+	}
+	if (policy < 0)
+	{
+		out << "Unknown placement policy " << parser.value("policy") << ".\n";
+		return 1;
+	}
+	settings.setPlacementPolicy(PlacementPolicy(policy));
+	settings.setTailTrimming(parser.isSet("trim"));
+	if (!ReferenceMemory::isSupported(&settings))
+	{
+		out << "The reference model has no order of splits, so the first found policy cannot be compared.\n";
+		return 1;
+	}
+
+	QVector<Command> loadedCmds;
+	if (loadCmds(parser.positionalArguments().first(), &loadedCmds) != QResult_Success)
+	{
+		out << "Cannot load commands from " << parser.positionalArguments().first() << ".\n";
+		return 1;
+	}
+	QVector<const Command*> cmds;
+	for (int cmdIndex = 0; cmdIndex < loadedCmds.size(); ++cmdIndex)
+	{
+		cmds.push_back(&loadedCmds.at(cmdIndex));
+	}
+
+	// instances of the fixed configurations in use
+	int result = 1;
+	if (parser.value("engine") == "memory")
+	{
+		NameTable names;
+		Memory mem(&settings, &names);
+		result = compare(&mem, cmds, &settings, parser.value("out"), out);
+	}
+	else if (parser.value("engine") == "fixed" && settings.getPlacementPolicy() == PlacementPolicy::LowestAddress &&
+			 !settings.getTailTrimming() && settings.getTotalMemoryDegree() == 24 && settings.getMinBlockDegree() == 4)
+	{
+		FixedMemory<24, 4>* mem = new FixedMemory<24, 4>();
+		result = compare(mem, cmds, &settings, parser.value("out"), out);
+		delete mem;
+	}
+	else if (parser.value("engine") == "fixed" && settings.getPlacementPolicy() == PlacementPolicy::LowestAddress &&
+			 !settings.getTailTrimming() && settings.getTotalMemoryDegree() == 16 && settings.getMinBlockDegree() == 3)
+	{
+		FixedMemory<16, 3>* mem = new FixedMemory<16, 3>();
+		result = compare(mem, cmds, &settings, parser.value("out"), out);
+		delete mem;
+	}
+	else
+	{
+		out << "Unknown engine " << parser.value("engine") << " or a configuration it is not built for.\n";
+	}
+	return result;
+}
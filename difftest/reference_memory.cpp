@@ -0,0 +1,231 @@
+#include "reference_memory.h"
+
+ReferenceMemory::ReferenceMemory(MemorySettings* settings) :
+	totalDegree(settings->getTotalMemoryDegree()),
+	minDegree(settings->getMinBlockDegree()),
+	policy(settings->getPlacementPolicy()),
+	tailTrimming(settings->getTailTrimming()),
+	lastFreedAddress(0)
+{
+	freeBlocks.resize(totalDegree + 1);
+	freeBlocks[totalDegree].insert(0, true);
+}
+
+bool ReferenceMemory::isSupported(MemorySettings* settings)
+{
+	return settings->getPlacementPolicy() != PlacementPolicy::FirstFound &&
+			settings->getCoalescingMode() == CoalescingMode::EagerCoalescing;
+}
+
+QResultStatus ReferenceMemory::allocate(const uint64_t bytes, const uint32_t procId)
+{
+	if (procId == NameTable::NO_NAME)
+	{
+		return QResult_IncorrectData;
+	}
+	if (allocations.contains(procId))
+	{
+		return QResult_ActionUnavailable;
+	}
+
+	uint8_t degree = minDegree;
+	while (degree <= totalDegree && MemorySettings::degreeToBytes(degree) < bytes)
+	{
+		++degree;
+	}
+	Piece piece;
+	if (degree > totalDegree || !findFree(degree, &piece))
+	{
+		return QResult_ActionUnavailable;
+	}
+
+	// the same preferred address steers the choice of the block and of the halves
+	uint64_t address = 0;
+	if (policy == PlacementPolicy::HighestAddress) address = UINT64_MAX;
+	else if (policy == PlacementPolicy::RecentlyFreed) address = lastFreedAddress;
+	piece = splitToward(piece, degree, address);
+
+	QVector<Piece> pieces;
+	if (tailTrimming)
+	{
+		// a run from the beginning of the block, the rest of it stays free
+		uint64_t minSize = MemorySettings::degreeToBytes(minDegree);
+		uint64_t size = qMax(minSize, (bytes + minSize - 1) & ~(minSize - 1));
+		while (size < MemorySettings::degreeToBytes(piece.degree))
+		{
+			--piece.degree;
+			uint64_t halfSize = MemorySettings::degreeToBytes(piece.degree);
+			Piece upper = { piece.address + halfSize, piece.degree };
+			if (size > halfSize)
+			{
+				pieces.push_back(piece);
+				size -= halfSize;
+				piece = upper;
+			}
+			else
+			{
+				freeBlocks[upper.degree].insert(upper.address, true);
+			}
+		}
+	}
+	pieces.push_back(piece);
+	allocations.insert(procId, pieces);
+	return QResult_Success;
+}
+
+QResultStatus ReferenceMemory::free(const uint32_t procId)
+{
+	if (!allocations.contains(procId))
+	{
+		return QResult_Failure;
+	}
+
+	QVector<Piece> pieces = allocations.take(procId);
+	lastFreedAddress = pieces.first().address;
+	foreach (const Piece& piece, pieces)
+	{
+		release(piece);
+	}
+	return QResult_Success;
+}
+
+uint64_t ReferenceMemory::getBeginAddress(const uint32_t procId) const
+{
+	return allocations.contains(procId) ? allocations.value(procId).first().address : UINT64_MAX;
+}
+
+uint64_t ReferenceMemory::getBlockSize(const uint32_t procId) const
+{
+	uint64_t size = 0;
+	foreach (const Piece& piece, allocations.value(procId))
+	{
+		size += MemorySettings::degreeToBytes(piece.degree);
+	}
+	return size;
+}
+
+uint64_t ReferenceMemory::getFreeBytes() const
+{
+	uint64_t freeBytes = 0;
+	for (uint8_t degree = 0; degree <= totalDegree; ++degree)
+	{
+		freeBytes += freeBlocks.at(degree).size() * MemorySettings::degreeToBytes(degree);
+	}
+	return freeBytes;
+}
+
+int16_t ReferenceMemory::getLargestFreeDegree() const
+{
+	for (int16_t degree = totalDegree; degree >= 0; --degree)
+	{
+		if (!freeBlocks.at(degree).isEmpty()) return degree;
+	}
+	return -1;
+}
+
+bool ReferenceMemory::findFree(const uint8_t degree, Piece* piece) const
+{
+	bool isFound = false;
+	for (uint8_t candidateDegree = degree; candidateDegree <= totalDegree; ++candidateDegree)
+	{
+		const QMap<uint64_t, bool>& blocks = freeBlocks.at(candidateDegree);
+		if (blocks.isEmpty()) continue;
+
+		Piece candidate = { 0, candidateDegree };
+		if (policy == PlacementPolicy::LowestAddress || policy == PlacementPolicy::BestFit)
+		{
+			candidate.address = blocks.firstKey();
+		}
+		else if (policy == PlacementPolicy::HighestAddress)
+		{
+			candidate.address = blocks.lastKey();
+		}
+		else
+		{
+			// the nearest block on either side of the last freed address, the lower one wins ties
+			QMap<uint64_t, bool>::const_iterator next = blocks.lowerBound(lastFreedAddress);
+			Piece previous = { 0, candidateDegree };
+			bool hasPrevious = false;
+			if (next != blocks.constBegin())
+			{
+				QMap<uint64_t, bool>::const_iterator before = next;
+				--before;
+				previous.address = before.key();
+				hasPrevious = true;
+			}
+			if (next == blocks.constEnd())
+			{
+				candidate = previous;
+			}
+			else
+			{
+				candidate.address = next.key();
+				if (hasPrevious && getDistance(previous, lastFreedAddress) <= getDistance(candidate, lastFreedAddress))
+				{
+					candidate = previous;
+				}
+			}
+		}
+
+		if (policy == PlacementPolicy::LowestAddress)
+		{
+			if (!isFound || candidate.address < piece->address) *piece = candidate;
+		}
+		else if (policy == PlacementPolicy::HighestAddress)
+		{
+			if (!isFound || candidate.address > piece->address) *piece = candidate;
+		}
+		else
+		{
+			// the smallest sufficient degree decides
+			*piece = candidate;
+			return true;
+		}
+		isFound = true;
+	}
+	return isFound;
+}
+
+ReferenceMemory::Piece ReferenceMemory::splitToward(Piece piece, const uint8_t degree, const uint64_t address)
+{
+	freeBlocks[piece.degree].remove(piece.address);
+	while (piece.degree > degree)
+	{
+		--piece.degree;
+		Piece lower = piece;
+		Piece upper = { piece.address + MemorySettings::degreeToBytes(piece.degree), piece.degree };
+		// the lower half wins ties
+		if (getDistance(upper, address) < getDistance(lower, address))
+		{
+			freeBlocks[lower.degree].insert(lower.address, true);
+			piece = upper;
+		}
+		else
+		{
+			freeBlocks[upper.degree].insert(upper.address, true);
+		}
+	}
+	return piece;
+}
+
+void ReferenceMemory::release(Piece piece)
+{
+	// merging with free buddies as long as there are any
+	while (piece.degree < totalDegree)
+	{
+		uint64_t buddy = piece.address ^ MemorySettings::degreeToBytes(piece.degree);
+		if (!freeBlocks.at(piece.degree).contains(buddy)) break;
+		freeBlocks[piece.degree].remove(buddy);
+		piece.address = qMin(piece.address, buddy);
+		++piece.degree;
+	}
+	freeBlocks[piece.degree].insert(piece.address, true);
+}
+
+uint64_t ReferenceMemory::getDistance(const Piece& piece, const uint64_t address)
+{
+	uint64_t endAddress = piece.address + MemorySettings::degreeToBytes(piece.degree);
+	if (address < piece.address) return piece.address - address;
+	if (address >= endAddress) return address - endAddress + 1;
+	return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef REFERENCE_MEMORY_H
+#define REFERENCE_MEMORY_H
+
+#include <QtCore/qglobal.h>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+
+#include "common.h"
+#include "memory_settings.h"
+#include "name_table.h"
+
+/// Plain model of a buddy allocator, kept simple enough to be checked by reading.
+/// Free blocks are addresses in one sorted map per degree, allocated blocks are lists of address and degree.
+/// Placement follows the address-defined policies of Memory with eager coalescing,
+/// the first found policy depends on the order of splits in the tree and is not modelled.
+class ReferenceMemory
+{
+	public:
+		explicit ReferenceMemory(MemorySettings* settings);
+
+		static bool isSupported(MemorySettings* settings);
+
+		QResultStatus allocate(const uint64_t bytes, const uint32_t procId);
+		QResultStatus free(const uint32_t procId);
+		uint64_t getBeginAddress(const uint32_t procId) const;
+		uint64_t getBlockSize(const uint32_t procId) const;
+		uint64_t getFreeBytes() const;
+		int16_t getLargestFreeDegree() const;
+
+	private:
+		/// Buddy block of the model.
+		struct Piece
+		{
+			uint64_t address;
+			uint8_t degree;
+		};
+
+		uint8_t totalDegree;
+		uint8_t minDegree;
+		PlacementPolicy policy;
+		bool tailTrimming;
+		/// Free blocks by degree, the value is unused.
+		QVector<QMap<uint64_t, bool> > freeBlocks;
+		QHash<uint32_t, QVector<Piece> > allocations;
+		uint64_t lastFreedAddress;
+
+		bool findFree(const uint8_t degree, Piece* piece) const;
+		Piece splitToward(Piece piece, const uint8_t degree, const uint64_t address);
+		void release(Piece piece);
+		static uint64_t getDistance(const Piece& piece, const uint64_t address);
+};
+
+#endif // REFERENCE_MEMORY_H
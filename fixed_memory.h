@@ -0,0 +1,170 @@
+#ifndef FIXED_MEMORY_H
+#define FIXED_MEMORY_H
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qalgorithms.h>
+#include <QHash>
+#include <array>
+
+#include "common.h"
+#include "name_table.h"
+
+/// Buddy memory of a configuration fixed at compile time, for production setups which never change it.
+/// The tree is implicit: node i has children 2i + 1 and 2i + 2, so it is one std::array of the largest
+/// free degree below every node and needs neither settings nor a node pool at run time.
+/// Blocks go to the lowest fitting address, like the lowest address policy of Memory with eager coalescing.
+template <uint8_t TotalDegree, uint8_t MinDegree>
+class FixedMemory
+{
+	static_assert(MinDegree <= TotalDegree && TotalDegree <= 30, "degrees are out of range");
+
+	public:
+		static constexpr uint8_t LEVELS_COUNT = TotalDegree - MinDegree + 1;
+		static constexpr uint32_t NODES_COUNT = (uint32_t(1) << LEVELS_COUNT) - 1;
+		static constexpr uint32_t NO_BLOCK = UINT32_MAX;
+
+		static constexpr uint64_t degreeToBytes(const uint8_t degree)
+		{
+			return uint64_t(1) << degree;
+		}
+
+		static constexpr uint8_t degreeToRow(const uint8_t degree)
+		{
+			return TotalDegree - degree;
+		}
+
+		/// Degree of the smallest block which holds the bytes, TotalDegree + 1 when no block does.
+		static uint8_t bytesToDegree(const uint64_t bytes)
+		{
+			// as MemorySettings::bytesToDegree(), the smallest blocks take what is below them
+			return qMax<uint8_t>(MinDegree, 64 - qCountLeadingZeroBits(quint64(bytes - (bytes != 0))));
+		}
+
+		FixedMemory()
+		{
+			clear();
+		}
+
+		QResultStatus allocate(const uint64_t bytes, const uint32_t procId)
+		{
+			if (procId == NameTable::NO_NAME)
+			{
+				return QResult_IncorrectData;
+			}
+			uint8_t degree = bytesToDegree(bytes);
+			if (namedBlocks.contains(procId) || degree > TotalDegree || longestFree[0] <= degree)
+			{
+				return QResult_ActionUnavailable;
+			}
+
+			// descending to the leftmost subtree which fits, free blocks are split on the way
+			uint32_t index = 0;
+			for (uint8_t nodeDegree = TotalDegree; nodeDegree > degree; --nodeDegree)
+			{
+				uint32_t child = 2 * index + 1;
+				if (longestFree[index] == nodeDegree + 1)
+				{
+					longestFree[child] = nodeDegree;
+					longestFree[child + 1] = nodeDegree;
+				}
+				index = (longestFree[child] > degree ? child : child + 1);
+			}
+
+			longestFree[index] = 0;
+			updateParents(index);
+			namedBlocks.insert(procId, index);
+			freeBytes -= degreeToBytes(degree);
+			return QResult_Success;
+		}
+
+		QResultStatus free(const uint32_t procId)
+		{
+			uint32_t index = namedBlocks.value(procId, NO_BLOCK);
+			if (index == NO_BLOCK)
+			{
+				return QResult_Failure;
+			}
+
+			namedBlocks.remove(procId);
+			uint8_t degree = getDegree(index);
+			longestFree[index] = degree + 1;
+			updateParents(index);
+			freeBytes += degreeToBytes(degree);
+			return QResult_Success;
+		}
+
+		void clear()
+		{
+			longestFree.fill(0);
+			longestFree[0] = TotalDegree + 1;
+			namedBlocks.clear();
+			freeBytes = degreeToBytes(TotalDegree);
+		}
+
+		/// Begin address of the block of the process, UINT64_MAX when it is not allocated.
+		uint64_t getBeginAddress(const uint32_t procId) const
+		{
+			uint32_t index = namedBlocks.value(procId, NO_BLOCK);
+			if (index == NO_BLOCK)
+			{
+				return UINT64_MAX;
+			}
+			uint8_t row = getRow(index);
+			return uint64_t(index + 1 - (uint32_t(1) << row)) << (TotalDegree - row);
+		}
+
+		uint64_t getBlockSize(const uint32_t procId) const
+		{
+			uint32_t index = namedBlocks.value(procId, NO_BLOCK);
+			return index == NO_BLOCK ? 0 : degreeToBytes(getDegree(index));
+		}
+
+		uint64_t getFreeBytes() const
+		{
+			return freeBytes;
+		}
+
+		int16_t getLargestFreeDegree() const
+		{
+			return int16_t(longestFree[0]) - 1;
+		}
+
+	private:
+		/// Degree plus one of the largest free block below every node, zero when there is none.
+		/// Children of a whole free block are stale until it is split.
+		std::array<uint8_t, NODES_COUNT> longestFree;
+		QHash<uint32_t, uint32_t> namedBlocks;
+		uint64_t freeBytes;
+
+		static uint8_t getRow(const uint32_t index)
+		{
+			return 31 - qCountLeadingZeroBits(quint32(index + 1));
+		}
+
+		static uint8_t getDegree(const uint32_t index)
+		{
+			return TotalDegree - getRow(index);
+		}
+
+		void updateParents(uint32_t index)
+		{
+			// buddies which are both whole free blocks merge into their parent
+			for (uint8_t degree = getDegree(index); index != 0; ++degree)
+			{
+				uint32_t parent = (index - 1) / 2;
+				uint8_t first = longestFree[2 * parent + 1];
+				uint8_t second = longestFree[2 * parent + 2];
+				longestFree[parent] = (first == degree + 1 && second == degree + 1 ? degree + 2 : qMax(first, second));
+				index = parent;
+			}
+		}
+};
+
+template <uint8_t TotalDegree, uint8_t MinDegree>
+constexpr uint8_t FixedMemory<TotalDegree, MinDegree>::LEVELS_COUNT;
+template <uint8_t TotalDegree, uint8_t MinDegree>
+constexpr uint32_t FixedMemory<TotalDegree, MinDegree>::NODES_COUNT;
+template <uint8_t TotalDegree, uint8_t MinDegree>
+constexpr uint32_t FixedMemory<TotalDegree, MinDegree>::NO_BLOCK;
+
+#endif // FIXED_MEMORY_H
@@ -0,0 +1,189 @@
+#include "free_bitmap.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+const uint32_t FreeBitmap::NOT_FOUND;
+
+FreeBitmap::FreeBitmap() :
+	count(0)
+{
+
+}
+
+void FreeBitmap::set(const uint32_t position)
+{
+	uint32_t word = position >> 6;
+	if (word >= (uint32_t)words.size())
+	{
+		words.resize(word + 1);
+		summary.resize((word >> 6) + 1);
+	}
+
+	quint64 bit = quint64(1) << (position & 63);
+	if ((words.at(word) & bit) == 0)
+	{
+		words[word] |= bit;
+		summary[word >> 6] |= quint64(1) << (word & 63);
+		++count;
+	}
+}
+
+void FreeBitmap::reset(const uint32_t position)
+{
+	uint32_t word = position >> 6;
+	quint64 bit = quint64(1) << (position & 63);
+	if (word < (uint32_t)words.size() && (words.at(word) & bit) != 0)
+	{
+		words[word] &= ~bit;
+		if (words.at(word) == 0)
+		{
+			summary[word >> 6] &= ~(quint64(1) << (word & 63));
+		}
+		--count;
+	}
+}
+
+bool FreeBitmap::test(const uint32_t position) const
+{
+	uint32_t word = position >> 6;
+	return word < (uint32_t)words.size() && (words.at(word) >> (position & 63)) & 1;
+}
+
+void FreeBitmap::clear()
+{
+	words.clear();
+	summary.clear();
+	count = 0;
+}
+
+uint32_t FreeBitmap::getCount() const
+{
+	return count;
+}
+
+uint32_t FreeBitmap::findFirst() const
+{
+	return findNext(0);
+}
+
+uint32_t FreeBitmap::findLast() const
+{
+	return findPrevious(NOT_FOUND - 1);
+}
+
+uint32_t FreeBitmap::findNext(const uint32_t position) const
+{
+	uint32_t word = position >> 6;
+	if (count == 0 || word >= (uint32_t)words.size())
+	{
+		return NOT_FOUND;
+	}
+
+	quint64 bits = words.at(word) & (~quint64(0) << (position & 63));
+	if (bits == 0)
+	{
+		// the next non-empty word is found through the summary
+		++word;
+		uint32_t summaryWord = word >> 6;
+		if (summaryWord >= (uint32_t)summary.size())
+		{
+			return NOT_FOUND;
+		}
+		quint64 summaryBits = summary.at(summaryWord) & (~quint64(0) << (word & 63));
+		if (summaryBits == 0)
+		{
+			summaryWord = findNonZeroForward(summary, summaryWord + 1);
+			if (summaryWord == NOT_FOUND)
+			{
+				return NOT_FOUND;
+			}
+			summaryBits = summary.at(summaryWord);
+		}
+		word = (summaryWord << 6) + qCountTrailingZeroBits(summaryBits);
+		bits = words.at(word);
+	}
+	return (word << 6) + qCountTrailingZeroBits(bits);
+}
+
+uint32_t FreeBitmap::findPrevious(const uint32_t position) const
+{
+	if (count == 0)
+	{
+		return NOT_FOUND;
+	}
+
+	uint32_t word = position >> 6;
+	quint64 bits = 0;
+	if (word >= (uint32_t)words.size())
+	{
+		word = words.size() - 1;
+		bits = words.at(word);
+	}
+	else
+	{
+		bits = words.at(word) & (~quint64(0) >> (63 - (position & 63)));
+	}
+
+	if (bits == 0)
+	{
+		if (word == 0)
+		{
+			return NOT_FOUND;
+		}
+		--word;
+		uint32_t summaryWord = word >> 6;
+		quint64 summaryBits = summary.at(summaryWord) & (~quint64(0) >> (63 - (word & 63)));
+		if (summaryBits == 0)
+		{
+			summaryWord = findNonZeroBackward(summary, summaryWord);
+			if (summaryWord == NOT_FOUND)
+			{
+				return NOT_FOUND;
+			}
+			summaryBits = summary.at(summaryWord);
+		}
+		word = (summaryWord << 6) + 63 - qCountLeadingZeroBits(summaryBits);
+		bits = words.at(word);
+	}
+	return (word << 6) + 63 - qCountLeadingZeroBits(bits);
+}
+
+uint32_t FreeBitmap::findNonZeroForward(const QVector<quint64>& values, uint32_t begin)
+{
+	uint32_t end = values.size();
+	const quint64* data = values.constData();
+#ifdef __SSE2__
+	// two words per compare, a mask of 0xffff means both are zero
+	const __m128i zero = _mm_setzero_si128();
+	for (; begin + 2 <= end; begin += 2)
+	{
+		__m128i pair = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + begin));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(pair, zero)) != 0xffff) break;
+	}
+#endif
+	for (; begin < end; ++begin)
+	{
+		if (data[begin] != 0) return begin;
+	}
+	return NOT_FOUND;
+}
+
+uint32_t FreeBitmap::findNonZeroBackward(const QVector<quint64>& values, uint32_t end)
+{
+	const quint64* data = values.constData();
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	for (; end >= 2; end -= 2)
+	{
+		__m128i pair = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + end - 2));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(pair, zero)) != 0xffff) break;
+	}
+#endif
+	for (; end > 0; --end)
+	{
+		if (data[end - 1] != 0) return end - 1;
+	}
+	return NOT_FOUND;
+}
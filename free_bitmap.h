@@ -0,0 +1,40 @@
+#ifndef FREE_BITMAP_H
+#define FREE_BITMAP_H
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qalgorithms.h>
+#include <QVector>
+
+#include "common.h"
+
+/// Set of free block positions of one level.
+/// Words are grown up to the highest position ever set, a summary bit per word marks non-empty words,
+/// so a search skips 4096 positions per summary word and finds the bit with count-trailing-zeros.
+class FreeBitmap
+{
+	public:
+		static const uint32_t NOT_FOUND = UINT32_MAX;
+
+		FreeBitmap();
+
+		void set(const uint32_t position);
+		void reset(const uint32_t position);
+		bool test(const uint32_t position) const;
+		void clear();
+		uint32_t getCount() const;
+
+		uint32_t findFirst() const;
+		uint32_t findLast() const;
+		uint32_t findNext(const uint32_t position) const;
+		uint32_t findPrevious(const uint32_t position) const;
+
+	private:
+		QVector<quint64> words;
+		QVector<quint64> summary;
+		uint32_t count;
+
+		static uint32_t findNonZeroForward(const QVector<quint64>& values, uint32_t begin);
+		static uint32_t findNonZeroBackward(const QVector<quint64>& values, uint32_t end);
+};
+
+#endif // FREE_BITMAP_H
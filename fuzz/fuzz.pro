@@ -0,0 +1,31 @@
+#-------------------------------------------------
+#
+# Fuzz harness of the buddy memory simulator
+#
+# The default build runs random inputs from its own driver,
+# "qmake CONFIG+=libfuzzer" links the target with libFuzzer instead.
+#
+#-------------------------------------------------
+
+QT       += core gui charts
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = CP_SSW_fuzz
+TEMPLATE = app
+CONFIG += console debug sanitizer sanitize_address sanitize_undefined
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+include(../core.pri)
+
+HEADERS += fuzz_target.h
+SOURCES += fuzz_target.cpp
+
+libfuzzer {
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer
+    QMAKE_LFLAGS += -fsanitize=fuzzer
+} else {
+    SOURCES += main.cpp
+}
@@ -0,0 +1,181 @@
+#include "fuzz_target.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "command_processor.h"
+
+/// Bytes of a fuzz input, zeros are read after its end.
+class FuzzInput
+{
+	public:
+		FuzzInput(const uint8_t* data, const size_t size) :
+			data(data),
+			size(size),
+			offset(0)
+		{
+
+		}
+
+		bool isEnd() const
+		{
+			return offset >= size;
+		}
+
+		uint8_t next()
+		{
+			return offset < size ? data[offset++] : 0;
+		}
+
+		uint32_t nextValue(const uint8_t bytesCount)
+		{
+			uint32_t value = 0;
+			for (uint8_t byteIndex = 0; byteIndex < bytesCount; ++byteIndex)
+			{
+				value = (value << 8) | next();
+			}
+			return value;
+		}
+
+	private:
+		const uint8_t* data;
+		size_t size;
+		size_t offset;
+};
+
+/// Commands decoded from one input, long inputs are cut.
+static const uint32_t MAX_CMDS_COUNT = 4096;
+/// Names are drawn from small sets, so frees and queries often hit allocated blocks.
+static const uint8_t NAMES_COUNT = 24;
+static const uint8_t CACHES_COUNT = 3;
+
+QResultStatus runFuzzInput(const uint8_t* data, const size_t size, QString* violation, uint64_t* stepsCount)
+{
+	FuzzInput input(data, size);
+
+	// small memory, so every step affords a check of the whole tree
+	MemorySettings settings;
+	settings.setTotalMemoryDegree(6 + input.next() % 11);
+	settings.setMinBlockDegree(1 + input.next() % (settings.getTotalMemoryDegree() - 1));
+	uint8_t policy = input.next();
+	settings.setPlacementPolicy(PlacementPolicy(policy % 5));
+	settings.setHugePageClustering(policy & 0x80);
+	uint8_t flags = input.next();
+	settings.setCoalescingMode(flags & 0x01 ? CoalescingMode::LazyCoalescing : CoalescingMode::EagerCoalescing);
+	settings.setCoalescingWatermark(1 + (flags >> 1) % 16);
+	settings.setTailTrimming(flags & 0x20);
+	uint8_t totalDegree = settings.getTotalMemoryDegree();
+
+	// every command carries a control which is applied after the command is executed
+	QVector<Command*> cmds;
+	QVector<uint8_t> controls;
+	QVector<uint16_t> targets;
+	while (!input.isEnd() && (uint32_t)cmds.size() < MAX_CMDS_COUNT)
+	{
+		uint8_t kind = input.next();
+		uint8_t nameIndex = input.next();
+		// command files cannot name pages of slabs, commands built in code can and still must not touch them
+		QString name = ((kind & 0x58) == 0x58 ? SlabAllocator::getPageName(QString("c%1").arg(nameIndex % CACHES_COUNT), nameIndex / CACHES_COUNT % 2)
+									: QString("p%1").arg(nameIndex % NAMES_COUNT));
+		QString objectName = QString("c%1:o%2").arg(nameIndex % CACHES_COUNT).arg(nameIndex / CACHES_COUNT % NAMES_COUNT);
+		// sizes up to twice the memory, spread over all degrees
+		uint64_t blockSize = input.nextValue(3) % (uint64_t(2) << (input.next() % (totalDegree + 1)));
+		// objects of one cache mostly share a size
+		uint64_t objectSize = (kind & 0x80 ? input.next() : (nameIndex % CACHES_COUNT + 1) * 24);
+
+		switch (kind % 8)
+		{
+			case 0:
+			case 1:
+			case 2:
+				cmds.push_back(new Command(CommandAction::Allocate, name, blockSize));
+				break;
+			case 3:
+			case 4:
+				cmds.push_back(new Command(CommandAction::Free, name, 0));
+				break;
+			case 5:
+				cmds.push_back(new Command(CommandAction::Query, kind & 0x20 ? objectName : name, 0));
+				break;
+			case 6:
+				cmds.push_back(new Command(CommandAction::CacheAllocate, objectName, objectSize));
+				break;
+			default:
+				cmds.push_back(new Command(CommandAction::CacheFree, objectName, 0));
+		}
+		controls.push_back(input.next());
+		targets.push_back(input.nextValue(2));
+	}
+
+	CommandProcessor* processor = new CommandProcessor(&settings);
+	processor->setUndoEnabled(flags & 0x40);
+	processor->setAnalyticsEnabled(flags & 0x80);
+	foreach (Command* cmd, cmds)
+	{
+		processor->addCmd(cmd);
+	}
+
+	// seeks may go back again and again, so steps are limited
+	QResultStatus resultStatus = QResult_Success;
+	uint64_t steps = 0;
+	uint64_t maxSteps = 4 * uint64_t(cmds.size());
+	QString result;
+	while (steps < maxSteps && resultStatus == QResult_Success)
+	{
+		int32_t cmdIndex = processor->getNextCmdIndex();
+		result.clear();
+		if (processor->execNextCmd(&result) != QResult_Success)
+		{
+			processor->skipNextCmd();
+		}
+		++steps;
+
+		QString stepName = cmds.at(cmdIndex)->cmdToStr();
+		switch (controls.at(cmdIndex) % 16)
+		{
+			case 0:
+				processor->stepBack();
+				stepName += ", step back";
+				break;
+			case 1:
+				processor->seekTo(targets.at(cmdIndex) % cmds.size());
+				stepName += QString(", seek to %1").arg(targets.at(cmdIndex) % cmds.size());
+				break;
+			case 2:
+				processor->resetExec();
+				stepName += ", reset";
+				break;
+			default:
+				break;
+		}
+
+		resultStatus = processor->checkInvariants(violation);
+		if (resultStatus != QResult_Success && violation != nullptr)
+		{
+			*violation = QString("%1 after command %2 \"%3\"").arg(*violation).arg(cmdIndex).arg(stepName);
+		}
+	}
+
+	// commands are not owned by the processor
+	delete processor;
+	foreach (Command* cmd, cmds)
+	{
+		delete cmd;
+	}
+	if (stepsCount != nullptr)
+	{
+		*stepsCount = steps;
+	}
+	return resultStatus;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	QString violation;
+	if (runFuzzInput(data, size, &violation) != QResult_Success)
+	{
+		fprintf(stderr, "Invariant violated: %s\n", qPrintable(violation));
+		abort();
+	}
+	return 0;
+}
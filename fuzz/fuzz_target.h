@@ -0,0 +1,14 @@
+#ifndef FUZZ_TARGET_H
+#define FUZZ_TARGET_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+
+#include "common.h"
+
+/// Decodes memory settings and a command stream from the input, runs the commands through
+/// CommandProcessor with steps back and seeks between them and checks invariants after every step.
+/// Returns QResult_IncorrectData with the violation described when an invariant does not hold.
+QResultStatus runFuzzInput(const uint8_t* data, const size_t size, QString* violation, uint64_t* stepsCount = nullptr);
+
+#endif // FUZZ_TARGET_H
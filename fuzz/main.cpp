@@ -0,0 +1,92 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+#include <random>
+
+#include "fuzz_target.h"
+
+static QResultStatus saveInput(const QString& path, const QByteArray& data)
+{
+	QFile file(path);
+	if (!file.open(QFile::WriteOnly)) {
+		return QResult_UnexpectedError;
+	}
+	file.write(data);
+	file.close();
+	return QResult_Success;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream out(stdout);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Runs random command streams through the simulator and checks its invariants after every step.");
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption("runs", "Random inputs to run.", "count", "10000"));
+	parser.addOption(QCommandLineOption("seed", "Seed of the random inputs.", "seed", "1"));
+	parser.addOption(QCommandLineOption("max-len", "Largest random input in bytes.", "bytes", "4096"));
+	parser.addPositionalArgument("inputs", "Inputs to replay instead of random ones, such as crashes saved by libFuzzer.", "[inputs...]");
+	parser.process(app);
+
+	QString violation;
+	uint64_t stepsCount = 0;
+	uint64_t totalSteps = 0;
+	QElapsedTimer timer;
+	timer.start();
+	if (!parser.positionalArguments().isEmpty())
+	{
+		foreach (const QString& path, parser.positionalArguments())
+		{
+			QFile file(path);
+			if (!file.open(QFile::ReadOnly)) {
+				out << "Cannot read " << path << ".\n";
+				return 1;
+			}
+			QByteArray data = file.readAll();
+			if (runFuzzInput((const uint8_t*)data.constData(), data.size(), &violation, &stepsCount) != QResult_Success)
+			{
+				out << path << ": " << violation << "\n";
+				return 1;
+			}
+			totalSteps += stepsCount;
+		}
+		out << "Inputs:        " << parser.positionalArguments().size() << " passed, " << totalSteps << " steps\n";
+		return 0;
+	}
+
+	uint64_t seed = parser.value("seed").toULongLong();
+	uint64_t runsCount = parser.value("runs").toULongLong();
+	uint32_t maxLength = qMax(1u, parser.value("max-len").toUInt());
+	std::mt19937_64 random(seed);
+	QByteArray data;
+	for (uint64_t run = 0; run < runsCount; ++run)
+	{
+		data.resize(random() % maxLength + 1);
+		for (int byteIndex = 0; byteIndex < data.size(); ++byteIndex)
+		{
+			data[byteIndex] = char(random());
+		}
+		if (runFuzzInput((const uint8_t*)data.constData(), data.size(), &violation, &stepsCount) != QResult_Success)
+		{
+			// the input is kept, so it can be replayed after a fix
+			QString path = QString("crash-%1-%2").arg(seed).arg(run);
+			out << "Run " << run << ": " << violation << "\n";
+			if (saveInput(path, data) == QResult_Success)
+			{
+				out << "Input saved to " << path << ".\n";
+			}
+			return 1;
+		}
+		totalSteps += stepsCount;
+	}
+
+	qint64 elapsed = timer.nsecsElapsed();
+	out << "Runs:          " << runsCount << " passed, " << totalSteps << " steps\n";
+	out << "Time:          " << QString::number(elapsed / 1e6, 'f', 2) << " ms, "
+		<< QString::number(totalSteps / (elapsed / 1e9) * 60 / 1e6, 'f', 2) << " M steps/min\n";
+	return 0;
+}
@@ -0,0 +1,135 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+
+#include "workload_generator.h"
+
+/// Replays the generator and compares the mean lifetime of freed processes with the configured one,
+/// processes born too late to die before the end of the trace are left out.
+static bool checkLifetimes(const WorkloadParams& params, QTextStream& err)
+{
+	// longer lifetimes are practically impossible for every distribution
+	uint64_t horizon = uint64_t(params.meanLifetime * (params.lifetimeDistribution == LifetimeDistribution::Exponential ? 20 : 2)) + 1;
+	if (params.cmdsCount < 2 * horizon)
+	{
+		err << "The trace is too short to measure lifetimes, " << 2 * horizon << " commands are needed.\n";
+		return false;
+	}
+
+	WorkloadGenerator generator(params);
+	QHash<uint64_t, uint64_t> births;
+	CommandAction action;
+	uint64_t procNumber = 0;
+	uint64_t size = 0;
+	uint64_t lifetimesSum = 0;
+	uint64_t freesCount = 0;
+	for (uint64_t cmdIndex = 0; cmdIndex < params.cmdsCount; ++cmdIndex)
+	{
+		generator.next(&action, &procNumber, &size);
+		if (action == CommandAction::Allocate || action == CommandAction::CacheAllocate)
+		{
+			if (cmdIndex < params.cmdsCount - horizon) births.insert(procNumber, cmdIndex);
+		}
+		else if ((action == CommandAction::Free || action == CommandAction::CacheFree) && births.contains(procNumber))
+		{
+			lifetimesSum += cmdIndex - births.take(procNumber);
+			++freesCount;
+		}
+	}
+
+	double expected = params.meanLifetime;
+	double measured = (freesCount != 0 ? double(lifetimesSum) / freesCount : 0);
+	bool isMatching = freesCount != 0 && births.isEmpty() && qAbs(measured - expected) <= 0.05 * expected;
+	err << "Lifetimes of " << freesCount << " processes: mean " << QString::number(measured, 'f', 2) << " commands, expected "
+		<< QString::number(expected, 'f', 2) << ", " << births.size() << " not freed, "
+		<< (isMatching ? "matching" : "NOT matching") << "\n";
+	return isMatching;
+}
+
+int main(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	QTextStream err(stderr);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Writes a synthetic command trace in the format of the simulator command files.");
+	parser.addHelpOption();
+	parser.addOption(QCommandLineOption("out", "Output file, standard output by default.", "file"));
+	parser.addOption(QCommandLineOption("ops", "Commands to generate.", "count", "1000000"));
+	parser.addOption(QCommandLineOption("size-dist", "Size distribution: uniform, lognormal or pow2.", "name", "lognormal"));
+	parser.addOption(QCommandLineOption("min-size", "Smallest request in bytes.", "bytes", "1"));
+	parser.addOption(QCommandLineOption("max-size", "Largest request in bytes.", "bytes", "1048576"));
+	parser.addOption(QCommandLineOption("median", "Median of the log-normal sizes in bytes.", "bytes", "1024"));
+	parser.addOption(QCommandLineOption("sigma", "Spread of the log-normal sizes.", "value", "1.5"));
+	parser.addOption(QCommandLineOption("pow2-bias", "Share of exact powers of two for pow2 sizes.", "value", "0.75"));
+	parser.addOption(QCommandLineOption("lifetime-dist", "Lifetime distribution: exponential, uniform or fixed.", "name", "exponential"));
+	parser.addOption(QCommandLineOption("lifetime", "Mean lifetime of a process in commands.", "count", "1000"));
+	parser.addOption(QCommandLineOption("alloc-ratio", "Share of allocations among commands on which no process dies.", "value", "1"));
+	parser.addOption(QCommandLineOption("query-ratio", "Share of queries among commands which would allocate.", "value", "0"));
+	parser.addOption(QCommandLineOption("max-live", "Processes alive at the same time.", "count", "1000"));
+	parser.addOption(QCommandLineOption("cache-ratio", "Share of allocations made as objects of slab caches.", "value", "0"));
+	parser.addOption(QCommandLineOption("max-object", "Object size of the largest slab cache.", "bytes", "512"));
+	parser.addOption(QCommandLineOption("seed", "Seed of the generator.", "seed", "1"));
+	parser.addOption(QCommandLineOption("check-lifetimes", "Verify that the measured mean lifetime matches the configured one."));
+	parser.process(app);
+
+	WorkloadParams params;
+	params.cmdsCount = parser.value("ops").toULongLong();
+	params.minSize = parser.value("min-size").toULongLong();
+	params.maxSize = parser.value("max-size").toULongLong();
+	params.sizeMedian = parser.value("median").toDouble();
+	params.sizeSigma = parser.value("sigma").toDouble();
+	params.powerOfTwoBias = parser.value("pow2-bias").toDouble();
+	params.meanLifetime = parser.value("lifetime").toDouble();
+	params.allocRatio = parser.value("alloc-ratio").toDouble();
+	params.queryRatio = parser.value("query-ratio").toDouble();
+	params.maxLiveProcesses = parser.value("max-live").toUInt();
+	params.cacheRatio = parser.value("cache-ratio").toDouble();
+	params.maxObjectSize = parser.value("max-object").toULongLong();
+	params.seed = parser.value("seed").toULongLong();
+	if (WorkloadParams::sizeDistributionFromString(parser.value("size-dist"), &params.sizeDistribution) != QResult_Success ||
+			WorkloadParams::lifetimeDistributionFromString(parser.value("lifetime-dist"), &params.lifetimeDistribution) != QResult_Success)
+	{
+		err << "Unknown distribution.\n";
+		return 1;
+	}
+
+	if (parser.isSet("check-lifetimes"))
+	{
+		return checkLifetimes(params, err) ? 0 : 1;
+	}
+
+	QFile file;
+	bool isOpened = false;
+	if (parser.isSet("out"))
+	{
+		file.setFileName(parser.value("out"));
+		isOpened = file.open(QFile::WriteOnly);
+	}
+	else
+	{
+		isOpened = file.open(stdout, QFile::WriteOnly);
+	}
+	if (!isOpened)
+	{
+		err << "Cannot open the output file.\n";
+		return 1;
+	}
+
+	QElapsedTimer timer;
+	timer.start();
+	WorkloadGenerator generator(params);
+	if (generator.toFile(&file) != QResult_Success)
+	{
+		err << "Cannot write commands.\n";
+		return 1;
+	}
+	qint64 elapsed = timer.nsecsElapsed();
+
+	err << "Generated " << params.cmdsCount << " commands in " << QString::number(elapsed / 1e6, 'f', 2) << " ms ("
+		<< QString::number(params.cmdsCount / (elapsed / 1e9) / 1e6, 'f', 3) << " M commands/s)\n";
+	return 0;
+}
@@ -0,0 +1,122 @@
+#include "latency_histogram.h"
+
+const uint8_t LatencyHistogram::SUB_BUCKET_BITS;
+const uint32_t LatencyHistogram::SUB_BUCKETS_COUNT;
+const uint32_t LatencyHistogram::BUCKETS_COUNT;
+
+LatencyHistogram::LatencyHistogram()
+{
+	clear();
+}
+
+void LatencyHistogram::record(const uint64_t value, const uint32_t sample)
+{
+	++buckets[bucketIndex(value)];
+	if (count == 0 || value < min) min = value;
+	if (count == 0 || value > max)
+	{
+		max = value;
+		maxSample = sample;
+	}
+	++count;
+	sum += value;
+}
+
+void LatencyHistogram::clear()
+{
+	buckets.fill(0, BUCKETS_COUNT);
+	count = 0;
+	min = 0;
+	max = 0;
+	maxSample = 0;
+	sum = 0;
+}
+
+uint64_t LatencyHistogram::getCount() const
+{
+	return count;
+}
+
+uint64_t LatencyHistogram::getMin() const
+{
+	return min;
+}
+
+uint64_t LatencyHistogram::getMax() const
+{
+	return max;
+}
+
+uint32_t LatencyHistogram::getMaxSample() const
+{
+	return maxSample;
+}
+
+double LatencyHistogram::getMean() const
+{
+	return count == 0 ? 0 : sum / count;
+}
+
+uint64_t LatencyHistogram::getPercentile(const double percent) const
+{
+	if (count == 0)
+	{
+		return 0;
+	}
+
+	// rank of the value, counted from one
+	uint64_t rank = qMax<uint64_t>(1, uint64_t(percent / 100 * count + 0.5));
+	uint64_t passed = 0;
+	for (uint32_t index = 0; index < BUCKETS_COUNT; ++index)
+	{
+		passed += buckets.at(index);
+		if (passed >= rank)
+		{
+			return qBound(min, bucketHighest(index), max);
+		}
+	}
+	return max;
+}
+
+QString LatencyHistogram::toString() const
+{
+	if (count == 0)
+	{
+		return "no commands";
+	}
+
+	return QString("p50 %1, p99 %2, p99.9 %3, max %4").arg(
+				durationToString(getPercentile(50)), durationToString(getPercentile(99)),
+				durationToString(getPercentile(99.9)), durationToString(max));
+}
+
+QString LatencyHistogram::durationToString(const uint64_t nanoseconds)
+{
+	if (nanoseconds < 1000) return QString("%1ns").arg(nanoseconds);
+	if (nanoseconds < 1000000) return QString("%1us").arg(QString::number(nanoseconds / 1e3, 'f', 2));
+	if (nanoseconds < 1000000000) return QString("%1ms").arg(QString::number(nanoseconds / 1e6, 'f', 2));
+	return QString("%1s").arg(QString::number(nanoseconds / 1e9, 'f', 2));
+}
+
+uint32_t LatencyHistogram::bucketIndex(const uint64_t value)
+{
+	// values below SUB_BUCKETS_COUNT have a bucket each,
+	// larger ones are placed by their highest SUB_BUCKET_BITS + 1 bits
+	if (value < SUB_BUCKETS_COUNT)
+	{
+		return uint32_t(value);
+	}
+	uint8_t shift = 63 - qCountLeadingZeroBits(quint64(value)) - SUB_BUCKET_BITS;
+	return (shift + 1) * SUB_BUCKETS_COUNT + uint32_t(value >> shift) - SUB_BUCKETS_COUNT;
+}
+
+uint64_t LatencyHistogram::bucketHighest(const uint32_t index)
+{
+	if (index < SUB_BUCKETS_COUNT)
+	{
+		return index;
+	}
+	uint8_t shift = index / SUB_BUCKETS_COUNT - 1;
+	uint64_t lowest = uint64_t(SUB_BUCKETS_COUNT + index % SUB_BUCKETS_COUNT) << shift;
+	return lowest + ((uint64_t(1) << shift) - 1);
+}
@@ -0,0 +1,51 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qalgorithms.h>
+#include <QString>
+#include <QVector>
+
+#include "common.h"
+
+/// Distribution of durations in nanoseconds with a bounded relative error.
+/// Every power of two is split into SUB_BUCKETS_COUNT equal buckets, so a bucket is
+/// at most 1/16 of its values wide, from single nanoseconds up to hours.
+class LatencyHistogram
+{
+	public:
+		static const uint8_t SUB_BUCKET_BITS = 4;
+		static const uint32_t SUB_BUCKETS_COUNT = 1 << SUB_BUCKET_BITS;
+		static const uint32_t BUCKETS_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS_COUNT;
+
+		LatencyHistogram();
+
+		/// Counts the value, the sample is kept when the value is the largest one.
+		void record(const uint64_t value, const uint32_t sample);
+		void clear();
+		uint64_t getCount() const;
+		uint64_t getMin() const;
+		uint64_t getMax() const;
+		/// Sample which the largest value was recorded with.
+		uint32_t getMaxSample() const;
+		double getMean() const;
+		/// Highest value equivalent to the percentile, within the error of a bucket.
+		uint64_t getPercentile(const double percent) const;
+		/// Percentiles of interest in a single line.
+		QString toString() const;
+
+		static QString durationToString(const uint64_t nanoseconds);
+
+	private:
+		QVector<uint64_t> buckets;
+		uint64_t count;
+		uint64_t min;
+		uint64_t max;
+		uint32_t maxSample;
+		double sum;
+
+		static uint32_t bucketIndex(const uint64_t value);
+		static uint64_t bucketHighest(const uint32_t index);
+};
+
+#endif // LATENCY_HISTOGRAM_H
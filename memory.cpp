@@ -1,142 +1,271 @@
 #include "memory.h"
+#include "state_buffer.h"
+#include "trace.h"
+
+const uint32_t Memory::ROOT;
 
 Memory::~Memory()
 {
-	blocks->clear();
-	delete blocks;
-	if (rootPair != nullptr)
-	{
-		delete rootPair;
-	}
+	delete backing;
 }
 
-Memory::Memory(MemorySettings* settings)
+Memory::Memory(MemorySettings* settings, NameTable* names) :
+	isUndoEnabled(false),
+	backing(nullptr),
+	backingPageMode(PageMode::Regular)
 {
 	this->settings = settings;
-	blocks = new tree_t();
-
-	size_t levelsCount = settings->getTotalMemoryDegree() + 1 - settings->getMinBlockDegree();
-	for (uint8_t levelIndex = 0; levelIndex < levelsCount; ++levelIndex)
-	{
-		blocks->push_back(new level_t());
-	}
-
-	rootPair = new pair_t(new Block(settings->getTotalMemoryDegree(), settings->getMinBlockDegree()), nullptr);
-	blocks->at(0)->push_back(rootPair);
+	this->names = names;
 
+	clear();
 	recalculateInfo();
 }
 
-QResultStatus Memory::allocate(const uint64_t bytes, const QString& procName)
+QResultStatus Memory::allocate(const uint64_t bytes, const uint32_t procId)
+{
+	return allocate(bytes, procId, MemorySettings::bytesToDegree(bytes));
+}
+
+QResultStatus Memory::allocate(const uint64_t bytes, const uint32_t procId, uint8_t searchedDegree)
 {
+	MEMORY_TRACE_SCOPE("Memory::allocate");
+	if (procId == NameTable::NO_NAME)
+	{
+		lastFailure = FailureReason::InvalidName;
+		return QResult_IncorrectData;
+	}
 	// looking for block with the same name
-	foreach (level_t* level, *blocks)
+	if (namedBlocks.contains(procId))
 	{
-		foreach (pair_t* pair, *level)
-		{
-			if ((pair->first != nullptr && pair->first->getProcName() == procName) ||
-					(pair->second != nullptr && pair->second->getProcName() == procName))
-			{
-				return QResult_ActionUnavailable;
-			}
-		}
+		lastFailure = FailureReason::DuplicateName;
+		return QResult_ActionUnavailable;
 	}
 
 	QResultStatus resultStatus = QResult_Success;
-	uint8_t searchedDegree = 0;
-	// looking for degree
-	for (uint64_t size = 1;
-		 searchedDegree <= settings->getTotalMemoryDegree() && size < bytes;
-		 ++searchedDegree, size <<= 1);
-
-	if (searchedDegree > settings->getTotalMemoryDegree())
+	if (searchedDegree > totalDegree)
 	{
+		lastFailure = FailureReason::TooLarge;
 		resultStatus = QResult_ActionUnavailable;
 	}
 	else
 	{
-		if (searchedDegree < settings->getMinBlockDegree())
+		if (searchedDegree < minDegree)
 		{
-			searchedDegree = settings->getMinBlockDegree();
+			searchedDegree = minDegree;
 		}
 
-		uint8_t rowIndex = settings->getTotalMemoryDegree() - searchedDegree;
-		bool isBlockFound = false;
-		foreach (pair_t* pair, *(blocks->at(rowIndex)))
+		uint8_t rowIndex = totalDegree - searchedDegree;
+		uint32_t freeBlock = findFreeBlock(rowIndex);
+		if (freeBlock == Block::NO_BLOCK && !deferredFrees.isEmpty())
 		{
-			if ((pair->first != nullptr && pair->first->isFree()) || (pair->second != nullptr && pair->second->isFree()))
-			{
-				Block* freeBlock = (pair->first != nullptr && pair->first->isFree() ? pair->first : pair->second);
-				freeBlock->setProcName(procName);
-				isBlockFound = true;
-				break;
-			}
+			// deferred merges may give a block large enough
+			coalesce();
+			freeBlock = findFreeBlock(rowIndex);
 		}
 
-		if (!isBlockFound)
+		if (freeBlock == Block::NO_BLOCK)
 		{
-			// then we must spit blocks until the needed level
-			Block* freeBlock = splitUntilDegree(settings->getTotalMemoryDegree() - searchedDegree);
-			if (freeBlock == nullptr)
+			lastFailure = FailureReason::OutOfMemory;
+			resultStatus = QResult_ActionUnavailable;
+		}
+		else
+		{
+			QVector<uint32_t> blocks;
+			if (tailTrimming)
 			{
-				resultStatus = QResult_ActionUnavailable;
+				// the request is rounded up to the smallest block only
+				uint64_t minSize = MemorySettings::degreeToBytes(minDegree);
+				splitTail(freeBlock, qMax(minSize, (bytes + minSize - 1) & ~(minSize - 1)), &blocks);
 			}
 			else
 			{
-				freeBlock->setProcName(procName);
+				blocks.push_back(freeBlock);
 			}
+
+			for (int blockIndex = 0; blockIndex < blocks.size(); ++blockIndex)
+			{
+				uint32_t index = blocks.at(blockIndex);
+				// the requested size is kept with the first block
+				nodes[index].setProcId(procId);
+				logUndo(UndoOp::Assign, index, 0, procId, blockIndex == 0 ? bytes : 0);
+				removeFreeBlock(index);
+				grantedBytes += MemorySettings::degreeToBytes(nodes.at(index).getDegree());
+			}
+			namedBlocks.insert(procId, blocks.first());
+			requestedSizes.insert(procId, bytes);
+			if (blocks.size() > 1)
+			{
+				tailBlocks.insert(procId, blocks.mid(1));
+			}
+			requestedBytes += bytes;
+			lastFailure = FailureReason::None;
 		}
 	}
 	return resultStatus;
 }
 
-QResultStatus Memory::free(const QString& procName)
+QResultStatus Memory::free(const uint32_t procId)
 {
-	QResultStatus resultStatus = QResult_Failure;
-	bool isBlockFound = false;
-	foreach (level_t* level, *blocks)
+	MEMORY_TRACE_SCOPE("Memory::free");
+	uint32_t blockToFree = namedBlocks.value(procId, Block::NO_BLOCK);
+	if (blockToFree == Block::NO_BLOCK)
 	{
-		foreach (pair_t* pair, *level)
-		{
-			if ((pair->first != nullptr && pair->first->getProcName() == procName) || (pair->second != nullptr && pair->second->getProcName() == procName))
-			{
-				Block* blockToFree = ((pair->first != nullptr && pair->first->getProcName() == procName) ? pair->first : pair->second);
-				resultStatus = this->free(blockToFree);
-				isBlockFound = true;
-				break;
-			}
-		}
-		if (isBlockFound)
+		lastFailure = FailureReason::NotAllocated;
+		return QResult_Failure;
+	}
+
+	uint64_t blockSize = MemorySettings::degreeToBytes(nodes.at(blockToFree).getDegree());
+	// the tail goes from its end, so reverting restores it in order
+	QVector<uint32_t> tail = tailBlocks.take(procId);
+	for (int tailIndex = tail.size() - 1; tailIndex >= 0; --tailIndex)
+	{
+		uint32_t index = tail.at(tailIndex);
+		blockSize += MemorySettings::degreeToBytes(nodes.at(index).getDegree());
+		logUndo(UndoOp::Release, index, 0, procId);
+		freeBlock(index);
+	}
+	// logged before merges, so it is reverted after them
+	logUndo(UndoOp::Release, blockToFree, 0, procId, requestedSizes.value(procId));
+	lastFreedAddress = nodes.at(blockToFree).getBeginAddress();
+	QResultStatus resultStatus = freeBlock(blockToFree);
+	if (resultStatus == QResult_Success)
+	{
+		namedBlocks.remove(procId);
+		requestedBytes -= requestedSizes.take(procId);
+		grantedBytes -= blockSize;
+		lastFailure = FailureReason::None;
+		if (coalescingMode == CoalescingMode::LazyCoalescing && (uint32_t)deferredFrees.size() >= coalescingWatermark)
 		{
-			break;
+			coalesce();
 		}
 	}
 	return resultStatus;
 }
 
-QString Memory::query(const QString& procName)
+QString Memory::query(const uint32_t procId)
 {
-	foreach (level_t* level, *blocks)
+	uint32_t index = namedBlocks.value(procId, Block::NO_BLOCK);
+	if (index == Block::NO_BLOCK)
 	{
-		foreach (pair_t* pair, *level)
-		{
-			if ((pair->first != nullptr && pair->first->getProcName() == procName)
-					|| (pair->second != nullptr && pair->second->getProcName() == procName))
-			{
-				Block* block = pair->first->getProcName() == procName ? pair->first : pair->second;
+		return QString("Block %1 not found.").arg(names->getName(procId));
+	}
+
+	const Block& block = nodes.at(index);
+	uint64_t size = getBlockSize(procId);
+	uint64_t beginAddress = block.getBeginAddress();
+	return QString("Block %1 > Size = %2 -> [%3; %4]").arg(
+				names->getName(block.getProcId()),
+				MemorySettings::bytesToString(size),
+				MemorySettings::bytesToString(beginAddress),
+				MemorySettings::bytesToString(beginAddress + size));
+}
+
+uint64_t Memory::getBeginAddress(const uint32_t procId) const
+{
+	uint32_t index = namedBlocks.value(procId, Block::NO_BLOCK);
+	return index == Block::NO_BLOCK ? UINT64_MAX : nodes.at(index).getBeginAddress();
+}
+
+QResultStatus Memory::setBackingEnabled(bool value, const PageMode mode)
+{
+	if (!value)
+	{
+		delete backing;
+		backing = nullptr;
+		return QResult_Success;
+	}
+	if (backing == nullptr)
+	{
+		backing = new BackingStore();
+	}
+	else if (backing->getSize() == MemorySettings::degreeToBytes(totalDegree) && backingPageMode == mode)
+	{
+		return QResult_Success;
+	}
+
+	backingPageMode = mode;
+	QResultStatus resultStatus = backing->reserve(totalDegree, mode);
+	if (resultStatus != QResult_Success)
+	{
+		delete backing;
+		backing = nullptr;
+	}
+	return resultStatus;
+}
+
+PageMode Memory::getBackingPageMode() const
+{
+	return backing == nullptr ? PageMode::Regular : backing->getPageMode();
+}
+
+uint64_t Memory::getBackingHugePageBytes() const
+{
+	return backing == nullptr ? 0 : backing->getHugePageBytes();
+}
 
-				uint64_t size = MemorySettings::degreeToBytes(block->getDegree());
-				uint64_t beginAddress = block->getBeginAddress();
+HugePageUsage Memory::getHugePageUsage() const
+{
+	uint8_t regionDegree = getRegionDegree();
+	uint64_t regionSize = MemorySettings::degreeToBytes(regionDegree);
+	QVector<uint64_t> regionFreeBytes(int(MemorySettings::degreeToBytes(totalDegree - regionDegree)), 0);
 
-				return QString("Block %1 > Size = %2 -> [%3; %4]").arg(
-							block->getProcName(),
-							MemorySettings::bytesToString(size),
-							MemorySettings::bytesToString(beginAddress),
-							MemorySettings::bytesToString(beginAddress + size));
+	// free leaves are summed by region, a leaf larger than a region covers several of them
+	QVector<uint32_t> stack;
+	stack.push_back(ROOT);
+	while (!stack.isEmpty())
+	{
+		const Block& block = nodes.at(stack.takeLast());
+		if (block.hasChilds())
+		{
+			stack.push_back(block.getSecondChild());
+			stack.push_back(block.getFirstChild());
+		}
+		else if (block.isFree())
+		{
+			uint64_t size = MemorySettings::degreeToBytes(block.getDegree());
+			uint64_t region = block.getBeginAddress() >> regionDegree;
+			for (uint64_t covered = 0; covered < size; covered += regionSize, ++region)
+			{
+				regionFreeBytes[region] += qMin(size, regionSize);
 			}
 		}
 	}
-	return QString("Block %1 not found.").arg(procName);
+
+	HugePageUsage usage = { 0, 0, 0 };
+	foreach (uint64_t freeBytes, regionFreeBytes)
+	{
+		if (freeBytes == regionSize) ++usage.freeCount;
+		else if (freeBytes == 0) ++usage.fullCount;
+		else ++usage.partialCount;
+	}
+	return usage;
+}
+
+uint8_t* Memory::getPointer(const uint32_t procId) const
+{
+	uint64_t beginAddress = getBeginAddress(procId);
+	if (backing == nullptr || beginAddress == UINT64_MAX)
+	{
+		return nullptr;
+	}
+	return backing->toPointer(beginAddress);
+}
+
+uint64_t Memory::getBlockSize(const uint32_t procId) const
+{
+	uint32_t index = namedBlocks.value(procId, Block::NO_BLOCK);
+	if (index == Block::NO_BLOCK)
+	{
+		return 0;
+	}
+
+	uint64_t size = MemorySettings::degreeToBytes(nodes.at(index).getDegree());
+	// the tail directly follows the first block
+	foreach (uint32_t tailIndex, tailBlocks.value(procId))
+	{
+		size += MemorySettings::degreeToBytes(nodes.at(tailIndex).getDegree());
+	}
+	return size;
 }
 
 QResultStatus Memory::toSvg(const QString& pathToFile)
@@ -149,55 +278,39 @@ QResultStatus Memory::toSvg(const QString& pathToFile)
 QChartView*Memory::toChart()
 {
 	// обход дерева в глубину с созданием сетов
-	/// Quantity of pairs where at least one free block.
 	QVector<QBarSet*>* sets = new QVector<QBarSet*>();
-	QSet<Block*>* viewedBlocks = new QSet<Block*>();
-
-	Block* curBlock = rootPair->first;
+	QVector<uint32_t> stack;
+	stack.push_back(ROOT);
 
-	while (curBlock != nullptr)
+	while (!stack.isEmpty())
 	{
-		// go to the left
-		if (curBlock->getFirstChild() != nullptr && !viewedBlocks->contains(curBlock->getFirstChild()))
+		const Block& curBlock = nodes.at(stack.takeLast());
+		if (curBlock.hasChilds())
 		{
-			curBlock = curBlock->getFirstChild();
-			continue;
-		}
-		// go to the right
-		if (curBlock->getSecondChild() != nullptr && !viewedBlocks->contains(curBlock->getSecondChild()))
-		{
-			curBlock = curBlock->getSecondChild();
+			// the left child is visited first
+			stack.push_back(curBlock.getSecondChild());
+			stack.push_back(curBlock.getFirstChild());
 			continue;
 		}
 
-		if (!curBlock->hasChilds())
+		uint64_t value = MemorySettings::degreeToBytes(curBlock.getDegree());
+		QBarSet* set = new QBarSet("");
+		*set << value;
+		// add to chart sets
+		if (curBlock.isFree())
 		{
-			uint64_t value = MemorySettings::degreeToBytes(curBlock->getDegree());
-			QBarSet* set = new QBarSet("");
-			*set << value;
-			// add to chart sets
-			if (curBlock->isFree())
-			{
-				set->setLabel(MemorySettings::degreeToString(curBlock->getDegree()));
-				set->setColor(QColor(0xe0, 0xe0, 0xe0));
-			}
-			else
-			{
-				QString label = MemorySettings::degreeToString(curBlock->getDegree());
-				label = QString("%1 = %2").arg(curBlock->getProcName(), label);
-				set->setLabel(label);
-				set->setColor(curBlock->getColor());
-			}
-			sets->push_back(set);
-			// move back to the parent
-			viewedBlocks->insert(curBlock);
-			curBlock = curBlock->getParent();
+			set->setLabel(MemorySettings::degreeToString(curBlock.getDegree()));
+			set->setColor(QColor(0xe0, 0xe0, 0xe0));
 		}
 		else
 		{
-			viewedBlocks->insert(curBlock);
-			curBlock = curBlock->getParent();
+			QString procName = names->getName(curBlock.getProcId());
+			QString label = MemorySettings::degreeToString(curBlock.getDegree());
+			label = QString("%1 = %2").arg(procName, label);
+			set->setLabel(label);
+			set->setColor(Block::getColor(procName));
 		}
+		sets->push_back(set);
 	}
 	// creating chart
 	QHorizontalPercentBarSeries *series = new QHorizontalPercentBarSeries();
@@ -211,8 +324,7 @@ QChartView*Memory::toChart()
 	chart->setAnimationOptions(QChart::NoAnimation);
 
 	QStringList categories;
-	uint8_t totalMemoryDegree = settings->getTotalMemoryDegree();
-	categories << MemorySettings::degreeToString(totalMemoryDegree);
+	categories << MemorySettings::degreeToString(totalDegree);
 	QBarCategoryAxis *axis = new QBarCategoryAxis();
 	axis->append(categories);
 	chart->createDefaultAxes();
@@ -223,29 +335,53 @@ QChartView*Memory::toChart()
 	chartView->setRenderHint(QPainter::Antialiasing);
 
 	delete sets;
-	delete viewedBlocks;
 
 	return chartView;
 }
 
 void Memory::clear()
 {
-	blocks->clear();
-	delete blocks;
-	if (rootPair != nullptr)
+	totalDegree = settings->getTotalMemoryDegree();
+	minDegree = settings->getMinBlockDegree();
+
+	nodes.clear();
+	freeSlots.clear();
+	levels.clear();
+	namedBlocks.clear();
+	requestedSizes.clear();
+	tailBlocks.clear();
+	tailTrimming = settings->getTailTrimming();
+	hugePageClustering = settings->getHugePageClustering();
+	requestedBytes = 0;
+	grantedBytes = 0;
+	lastFailure = FailureReason::None;
+	undoLog.clear();
+
+	policy = settings->getPlacementPolicy();
+	lastFreedAddress = 0;
+	freeBlocks.clear();
+	coalescingMode = settings->getCoalescingMode();
+	coalescingWatermark = settings->getCoalescingWatermark();
+	deferredFrees.clear();
+	splitsCount = 0;
+	mergesCount = 0;
+	if (backing != nullptr)
 	{
-		delete rootPair;
+		// the region follows the total size of memory
+		setBackingEnabled(true, backingPageMode);
 	}
-	blocks = new tree_t();
 
-	size_t levelsCount = settings->getTotalMemoryDegree() + 1 - settings->getMinBlockDegree();
-	for (uint8_t levelIndex = 0; levelIndex < levelsCount; ++levelIndex)
+	size_t levelsCount = totalDegree + 1 - minDegree;
+	levels.resize(levelsCount);
+	freeCounts.fill(0, levelsCount);
+	if (policy != PlacementPolicy::FirstFound)
 	{
-		blocks->push_back(new level_t());
+		freeBlocks.resize(levelsCount);
 	}
 
-	rootPair = new pair_t(new Block(settings->getTotalMemoryDegree(), settings->getMinBlockDegree()), nullptr);
-	blocks->at(0)->push_back(rootPair);
+	nodes.push_back(Block(totalDegree, Block::NO_BLOCK, 0));
+	levels[0].push_back(ROOT);
+	addFreeBlock(ROOT);
 }
 
 void Memory::recalculateInfo()
@@ -258,25 +394,22 @@ void Memory::recalculateInfo()
 	uint64_t usedMemory = 0;
 	uint64_t blockSize = 0;
 	uint64_t smallestBlockSize = UINT64_MAX;
-	foreach (level_t* level, *blocks)
+	for (uint8_t rowIndex = 0; rowIndex < levels.size(); ++rowIndex)
 	{
-		foreach (pair_t* pair, *level)
+		foreach (uint32_t slot, levels.at(rowIndex))
 		{
-			Block* block = nullptr;
-			for (uint8_t blockIndex = 0; blockIndex < 2; ++blockIndex)
+			for (uint32_t index = slot; index < slot + (rowIndex == 0 ? 1 : 2); ++index)
 			{
-				if (blockIndex == 0) block = pair->first;
-				else block = pair->second;
-
-				if (block != nullptr && !block->hasChilds())
+				const Block& block = nodes.at(index);
+				if (!block.hasChilds())
 				{
 					MemoryInfo::blocksQuantity++;
-					blockSize = MemorySettings::degreeToBytes(block->getDegree());
+					blockSize = MemorySettings::degreeToBytes(block.getDegree());
 					if (smallestBlockSize > blockSize)
 					{
 						smallestBlockSize = blockSize;
 					}
-					if (block->getProcName().length())
+					if (block.getProcId() != NameTable::NO_NAME)
 					{
 						usedMemory += blockSize;
 					}
@@ -286,131 +419,1118 @@ void Memory::recalculateInfo()
 	}
 
 	MemoryInfo::smallestBlockSize = MemorySettings::bytesToString(smallestBlockSize);
-	MemoryInfo::usedPercent = (double)usedMemory / (double)MemorySettings::degreeToBytes(settings->getTotalMemoryDegree());
+	MemoryInfo::usedPercent = (double)usedMemory / (double)MemorySettings::degreeToBytes(totalDegree);
 	MemoryInfo::usedMemory = MemorySettings::bytesToString(usedMemory);
 }
 
-Block* Memory::splitUntilDegree(const uint8_t degree)
+uint32_t Memory::getNodesCount() const
 {
-	// looking for the last level with free blocks
-	int16_t splitLevel = degree - 1;
-	Block* freeBlock = nullptr;
-	for (; splitLevel >= 0; --splitLevel)
+	return nodes.size() - 2 * freeSlots.size();
+}
+
+QResultStatus Memory::saveState(QByteArray* state) const
+{
+	if (state == nullptr)
+	{
+		return QResult_NullPointer;
+	}
+
+	// shape of the tree in preorder, two bits per node: free, allocated or split
+	QByteArray bitmap;
+	QVector<uint32_t> allocated;
+	uint32_t nodesCount = 0;
+	QVector<uint32_t> stack;
+	stack.push_back(ROOT);
+	while (!stack.isEmpty())
+	{
+		uint32_t index = stack.takeLast();
+		const Block& block = nodes.at(index);
+		uint8_t code = 0;
+		if (block.hasChilds())
+		{
+			code = 2;
+			stack.push_back(block.getSecondChild());
+			stack.push_back(block.getFirstChild());
+		}
+		else if (block.getProcId() != NameTable::NO_NAME)
+		{
+			code = 1;
+			allocated.push_back(index);
+		}
+
+		if (nodesCount % 4 == 0)
+		{
+			bitmap.append('\0');
+		}
+		bitmap[bitmap.size() - 1] = char(bitmap.at(bitmap.size() - 1) | (code << (nodesCount % 4 * 2)));
+		++nodesCount;
+	}
+
+	state->clear();
+	appendValue(state, totalDegree);
+	appendValue(state, minDegree);
+	appendValue(state, lastFreedAddress);
+	appendValue(state, splitsCount);
+	appendValue(state, mergesCount);
+	appendValue(state, nodesCount);
+	state->append(bitmap);
+	foreach (uint32_t index, allocated)
+	{
+		uint32_t procId = nodes.at(index).getProcId();
+		appendValue(state, procId);
+		appendValue(state, requestedSizes.value(procId));
+	}
+	// order of pairs on every level decides which of equal free blocks is taken first
+	for (uint8_t rowIndex = 1; rowIndex < levels.size(); ++rowIndex)
+	{
+		appendValue(state, uint32_t(levels.at(rowIndex).size()));
+		foreach (uint32_t slot, levels.at(rowIndex))
+		{
+			appendValue(state, nodes.at(slot).getPosition() / 2);
+		}
+	}
+	// blocks waiting for lazy coalescing, in their order
+	appendValue(state, uint32_t(deferredFrees.size()));
+	foreach (uint32_t index, deferredFrees)
 	{
-		if (blocks->at(splitLevel)->size() != 0)
+		appendValue(state, uint8_t(totalDegree - nodes.at(index).getDegree()));
+		appendValue(state, nodes.at(index).getPosition());
+	}
+	return QResult_Success;
+}
+
+QResultStatus Memory::loadState(const QByteArray& state)
+{
+	clear();
+	try {
+		int offset = 0;
+		uint8_t savedTotalDegree = 0;
+		uint8_t savedMinDegree = 0;
+		uint32_t nodesCount = 0;
+		uint64_t savedLastFreedAddress = 0;
+		uint64_t savedSplitsCount = 0;
+		uint64_t savedMergesCount = 0;
+		if (!readValue(state, &offset, &savedTotalDegree) || !readValue(state, &offset, &savedMinDegree) ||
+				!readValue(state, &offset, &savedLastFreedAddress) || !readValue(state, &offset, &savedSplitsCount) ||
+				!readValue(state, &offset, &savedMergesCount) || !readValue(state, &offset, &nodesCount)) {
+			throw QResult_IncorrectData;
+		}
+		// states of other memory settings are not compatible
+		if (savedTotalDegree != totalDegree || savedMinDegree != minDegree) {
+			throw QResult_IncorrectData;
+		}
+
+		lastFreedAddress = savedLastFreedAddress;
+
+		int bitmapOffset = offset;
+		offset += (nodesCount + 3) / 4;
+		if (offset > state.size()) {
+			throw QResult_IncorrectData;
+		}
+
+		QVector<uint32_t> stack;
+		stack.push_back(ROOT);
+		for (uint32_t nodeIndex = 0; nodeIndex < nodesCount; ++nodeIndex)
 		{
-			foreach (pair_t* pair, *(blocks->at(splitLevel)))
+			if (stack.isEmpty()) {
+				throw QResult_IncorrectData;
+			}
+			uint32_t index = stack.takeLast();
+			uint8_t code = (uint8_t(state.at(bitmapOffset + nodeIndex / 4)) >> (nodeIndex % 4 * 2)) & 3;
+			if (code == 2)
 			{
-				if ((pair->first != nullptr && pair->first->isFree()) ||
-						(pair->second != nullptr && pair->second->isFree()))
+				uint32_t slot = split(index);
+				if (slot == Block::NO_BLOCK) {
+					throw QResult_IncorrectData;
+				}
+				stack.push_back(slot + 1);
+				stack.push_back(slot);
+			}
+			else if (code == 1)
+			{
+				uint32_t procId = NameTable::NO_NAME;
+				uint64_t bytes = 0;
+				if (!readValue(state, &offset, &procId) || !readValue(state, &offset, &bytes) ||
+						procId == NameTable::NO_NAME) {
+					throw QResult_IncorrectData;
+				}
+				uint8_t degree = nodes.at(index).getDegree();
+				nodes[index].setProcId(procId);
+				// blocks come by address, so the first one of a process is met before its tail
+				if (namedBlocks.contains(procId))
 				{
-					freeBlock = ((pair->first != nullptr && pair->first->isFree()) ? pair->first : pair->second);
-					break;
+					tailBlocks[procId].push_back(index);
 				}
+				else
+				{
+					namedBlocks.insert(procId, index);
+					requestedSizes.insert(procId, bytes);
+					requestedBytes += bytes;
+				}
+				removeFreeBlock(index);
+				grantedBytes += MemorySettings::degreeToBytes(degree);
 			}
-			if (freeBlock != nullptr) break;
 		}
-	}
-	// begins splitting
-	if (freeBlock != nullptr)
-	{
-		for (; splitLevel != degree; ++splitLevel)
+		// the restored tree is the new starting point
+		undoLog.clear();
+		if (!stack.isEmpty()) {
+			throw QResult_IncorrectData;
+		}
+
+		// restoring the order of pairs on every level
+		for (uint8_t rowIndex = 1; rowIndex < levels.size(); ++rowIndex)
 		{
-			pair_t* pair = freeBlock->split();
-			if (pair == nullptr)
+			QHash<uint32_t, uint32_t> pairSlots;
+			foreach (uint32_t slot, levels.at(rowIndex))
 			{
-				freeBlock = nullptr;
-				break;
+				pairSlots.insert(nodes.at(slot).getPosition() / 2, slot);
+			}
+			uint32_t pairsCount = 0;
+			if (!readValue(state, &offset, &pairsCount) || pairsCount != (uint32_t)pairSlots.size()) {
+				throw QResult_IncorrectData;
+			}
+			level_t& level = levels[rowIndex];
+			level.clear();
+			for (uint32_t pairIndex = 0; pairIndex < pairsCount; ++pairIndex)
+			{
+				uint32_t position = 0;
+				if (!readValue(state, &offset, &position) || !pairSlots.contains(position)) {
+					throw QResult_IncorrectData;
+				}
+				level.push_back(pairSlots.take(position));
+			}
+		}
+
+		uint32_t deferredCount = 0;
+		if (!readValue(state, &offset, &deferredCount)) {
+			throw QResult_IncorrectData;
+		}
+		for (uint32_t deferredIndex = 0; deferredIndex < deferredCount; ++deferredIndex)
+		{
+			uint8_t rowIndex = 0;
+			uint32_t position = 0;
+			if (!readValue(state, &offset, &rowIndex) || !readValue(state, &offset, &position) || rowIndex >= levels.size()) {
+				throw QResult_IncorrectData;
 			}
-			freeBlock = pair->first;
-			blocks->at(splitLevel+1)->push_back(pair);
+			uint32_t index = findNode(rowIndex, position);
+			if (index == Block::NO_BLOCK) {
+				throw QResult_IncorrectData;
+			}
+			deferredFrees.push_back(index);
 		}
+		splitsCount = savedSplitsCount;
+		mergesCount = savedMergesCount;
+
+		return QResult_Success;
+	} catch (QResultStatus resultStatus) {
+		clear();
+		return resultStatus;
 	}
-	return freeBlock;
 }
 
-QResultStatus Memory::free(Block* block)
+void Memory::setUndoEnabled(bool value)
+{
+	isUndoEnabled = value;
+	undoLog.clear();
+}
+
+void Memory::clearUndoLog()
+{
+	undoLog.clear();
+}
+
+uint32_t Memory::getUndoOpsCount() const
+{
+	return undoLog.size();
+}
+
+QResultStatus Memory::undoTo(const uint32_t opsCount)
 {
-	QResultStatus resultStatus = QResult_Failure;
-	if (block == nullptr)
+	if (opsCount > (uint32_t)undoLog.size())
 	{
-		return resultStatus;
+		return QResult_IndexOutOfRange;
+	}
+	// reverting in the opposite order, so every change meets the state it was made in
+	while ((uint32_t)undoLog.size() > opsCount)
+	{
+		undo(undoLog.takeLast());
 	}
+	lastFailure = FailureReason::None;
+	return QResult_Success;
+}
+
+uint8_t Memory::getTotalDegree() const
+{
+	return totalDegree;
+}
 
-	bool isBlockFound = false;
-	foreach (level_t* level, *blocks)
+uint8_t Memory::getMinDegree() const
+{
+	return minDegree;
+}
+
+uint32_t Memory::getFreeCount(const uint8_t degree) const
+{
+	if (degree > totalDegree || degree < minDegree)
 	{
-		foreach (pair_t* pair, *level)
-		{
-			if (pair->first == block || pair->second == block)
-			{
-				Block* neighbour = pair->first == block ? pair->second : pair->first;
-				Block* parent = block->getParent();
-				resultStatus = block->free();
-				// trying to merge
-				if (resultStatus == QResult_Success && block->merge(neighbour) == QResult_Success)
-				{
-					level->removeOne(pair);
-					if (pair != nullptr) delete pair;
-					this->free(parent);
-				}
-				isBlockFound = true;
-				break;
-			}
-		}
-		if (isBlockFound)
+		return 0;
+	}
+	return freeCounts.at(totalDegree - degree);
+}
+
+int16_t Memory::getLargestFreeDegree() const
+{
+	return nodes.at(ROOT).getLongestFreeDegree();
+}
+
+uint64_t Memory::getSplitsCount() const
+{
+	return splitsCount;
+}
+
+uint64_t Memory::getMergesCount() const
+{
+	return mergesCount;
+}
+
+uint32_t Memory::getDeferredCount() const
+{
+	return deferredFrees.size();
+}
+
+void Memory::coalesce()
+{
+	while (!deferredFrees.isEmpty())
+	{
+		uint32_t index = deferredFrees.takeLast();
+		logUndo(UndoOp::Undefer, index);
+		// blocks which were allocated or split again meanwhile are skipped,
+		// as well as the ones released when their buddy was merged earlier in this pass
+		const Block& block = nodes.at(index);
+		if (block.isFree() && (index == ROOT || nodes.at(block.getParent()).hasChilds()))
 		{
-			break;
+			mergeWithBuddy(index);
 		}
 	}
-	return resultStatus;
 }
 
-QResultStatus Memory::memToDot(QString* result)
+uint64_t Memory::getFreeBytes() const
+{
+	uint64_t freeBytes = 0;
+	for (uint8_t rowIndex = 0; rowIndex < freeCounts.size(); ++rowIndex)
+	{
+		freeBytes += uint64_t(freeCounts.at(rowIndex)) << (totalDegree - rowIndex);
+	}
+	return freeBytes;
+}
+
+uint64_t Memory::getRequestedBytes() const
+{
+	return requestedBytes;
+}
+
+uint64_t Memory::getGrantedBytes() const
+{
+	return grantedBytes;
+}
+
+FailureReason Memory::getLastFailure() const
+{
+	return lastFailure;
+}
+
+QResultStatus Memory::checkInvariants(QString* violation) const
 {
+	QString problem;
 	try {
-		// if no nodes
-		if (blocks->size() == 0) {
-			throw QResult_ActionUnavailable;
-		}
-		*result = "digraph Memory{\n";
-		foreach (level_t* level, *blocks)
+		// walking the tree from the root, every node has to be reached exactly once
+		QVector<bool> isReached(nodes.size(), false);
+		QVector<uint32_t> freeLeaves(levels.size(), 0);
+		QVector<uint32_t> pairsCount(levels.size(), 0);
+		uint32_t reachedCount = 0;
+		uint32_t allocatedLeaves = 0;
+		uint64_t allocatedBytes = 0;
+		QVector<uint32_t> stack;
+		stack.push_back(ROOT);
+		while (!stack.isEmpty())
 		{
-			foreach (pair_t* pair, *level)
+			uint32_t index = stack.takeLast();
+			if (index >= (uint32_t)nodes.size() || isReached.at(index)) {
+				problem = QString("node %1 is out of the pool or reached twice").arg(index);
+				throw QResult_IncorrectData;
+			}
+			isReached[index] = true;
+			++reachedCount;
+
+			const Block& block = nodes.at(index);
+			if (block.getDegree() < minDegree || block.getDegree() > totalDegree) {
+				problem = QString("node %1 has degree %2").arg(index).arg(block.getDegree());
+				throw QResult_IncorrectData;
+			}
+			uint8_t rowIndex = totalDegree - block.getDegree();
+			// the address is aligned to the size as long as the position is derived from the parent
+			if (uint64_t(block.getPosition()) >= (uint64_t(1) << rowIndex)) {
+				problem = QString("node %1 lies beyond the end of memory").arg(index);
+				throw QResult_IncorrectData;
+			}
+			if (index != ROOT)
 			{
-				for (uint8_t index = 0; index < 2; ++index)
-				{
-					Block* block = (index == 0 ? pair->first : pair->second);
-					if (block != nullptr)
-					{
-						uint8_t degree = block->getDegree();
-						QString label = MemorySettings::degreeToString(degree);
-						result->append(QString("%1 ").arg(QString::number((uint64_t(block)))));
-						if (!block->isFree())
-						{
-							QString code = "";
-							if (block->getProcName().length() != 0)
-							{
-								QString color = block->getColor().name();
-								code = QString(" [label=\"%1 = %2\", color=\"%3\", fontcolor=\"#000000\", style=filled];\n").arg(block->getProcName(), label, color);
-							}
-							else
-							{
-								code = QString(" [label=\"%1\", color=\"#e0e0e0\", fontcolor=\"#000000\", style=filled];\n").arg(label);
-							}
-							result->append(code);
-						}
-						else
-						{
-							QString code = QString(" [label=\"%1\"];").arg(label);
-							result->append(code);
-						}
-						// adding link from parent
-						if (block->getParent() != nullptr)
-						{
-							QString code = QString("%1 -> %2;\n").arg(QString::number(uint64_t(block->getParent())), QString::number(uint64_t(block)));
-							result->append(code);
-						}
+				const Block& parent = nodes.at(block.getParent());
+				uint32_t side = index - parent.getFirstChild();
+				if (!parent.hasChilds() || side > 1 || block.getDegree() + 1 != parent.getDegree() ||
+						block.getPosition() != parent.getPosition() * 2 + side) {
+					problem = QString("node %1 does not match its parent %2").arg(index).arg(block.getParent());
+					throw QResult_IncorrectData;
+				}
+			}
+			else if (block.getParent() != Block::NO_BLOCK || block.getPosition() != 0) {
+				problem = "root has a parent";
+				throw QResult_IncorrectData;
+			}
+
+			uint8_t longestFree = 0;
+			if (block.hasChilds())
+			{
+				uint32_t slot = block.getFirstChild();
+				if (block.getProcId() != NameTable::NO_NAME || slot + 1 >= (uint32_t)nodes.size()) {
+					problem = QString("split node %1 is allocated or has children out of the pool").arg(index);
+					throw QResult_IncorrectData;
+				}
+				longestFree = qMax(nodes.at(slot).longestFree, nodes.at(slot + 1).longestFree);
+				++pairsCount[rowIndex + 1];
+				stack.push_back(slot);
+				stack.push_back(slot + 1);
+
+				// buddies are merged at once, unless one of them waits for lazy coalescing
+				if (nodes.at(slot).isFree() && nodes.at(slot + 1).isFree() &&
+						(coalescingMode == CoalescingMode::EagerCoalescing ||
+						 (!deferredFrees.contains(slot) && !deferredFrees.contains(slot + 1)))) {
+					problem = QString("children of node %1 are both free").arg(index);
+					throw QResult_IncorrectData;
+				}
+			}
+			else if (block.getProcId() == NameTable::NO_NAME)
+			{
+				longestFree = block.getDegree() + 1;
+				++freeLeaves[rowIndex];
+				if (policy != PlacementPolicy::FirstFound && !freeBlocks.at(rowIndex).test(block.getPosition())) {
+					problem = QString("free node %1 is not in the free bitmap").arg(index);
+					throw QResult_IncorrectData;
+				}
+			}
+			else
+			{
+				uint32_t procId = block.getProcId();
+				if (namedBlocks.value(procId, Block::NO_BLOCK) != index && !tailBlocks.value(procId).contains(index)) {
+					problem = QString("node %1 is not indexed by its process %2").arg(index).arg(names->getName(procId));
+					throw QResult_IncorrectData;
+				}
+				++allocatedLeaves;
+				allocatedBytes += MemorySettings::degreeToBytes(block.getDegree());
+			}
+			if (block.longestFree != longestFree) {
+				problem = QString("node %1 has a wrong largest free block below it").arg(index);
+				throw QResult_IncorrectData;
+			}
+		}
+
+		// free lists
+		for (uint8_t rowIndex = 0; rowIndex < levels.size(); ++rowIndex)
+		{
+			if (freeCounts.at(rowIndex) != freeLeaves.at(rowIndex) ||
+					(policy != PlacementPolicy::FirstFound && freeBlocks.at(rowIndex).getCount() != freeLeaves.at(rowIndex))) {
+				problem = QString("free count of level %1 is wrong").arg(rowIndex);
+				throw QResult_IncorrectData;
+			}
+			if (rowIndex == 0 ? levels.at(0).size() != 1 || levels.at(0).first() != ROOT
+							  : (uint32_t)levels.at(rowIndex).size() != pairsCount.at(rowIndex)) {
+				problem = QString("level %1 lists a wrong quantity of pairs").arg(rowIndex);
+				throw QResult_IncorrectData;
+			}
+			if (rowIndex == 0) continue;
+			foreach (uint32_t slot, levels.at(rowIndex))
+			{
+				// pairs are counted above, so a listed first child of a reached parent is listed once
+				if (slot >= (uint32_t)nodes.size() || !isReached.at(slot) || nodes.at(slot).getDegree() != totalDegree - rowIndex ||
+						nodes.at(nodes.at(slot).getParent()).getFirstChild() != slot) {
+					problem = QString("level %1 lists slot %2 which is not a pair of the level").arg(rowIndex).arg(slot);
+					throw QResult_IncorrectData;
+				}
+			}
+		}
+		QSet<uint32_t> releasedSlots;
+		foreach (uint32_t slot, freeSlots)
+		{
+			if (slot + 1 >= (uint32_t)nodes.size() || isReached.at(slot) || isReached.at(slot + 1) || releasedSlots.contains(slot)) {
+				problem = QString("released slot %1 is in use").arg(slot);
+				throw QResult_IncorrectData;
+			}
+			releasedSlots.insert(slot);
+		}
+		if (reachedCount + 2 * (uint32_t)freeSlots.size() != (uint32_t)nodes.size()) {
+			problem = "pool has slots which are neither used nor released";
+			throw QResult_IncorrectData;
+		}
+		if (coalescingMode == CoalescingMode::EagerCoalescing && !deferredFrees.isEmpty()) {
+			problem = "frees are deferred by eager coalescing";
+			throw QResult_IncorrectData;
+		}
+
+		// name index
+		uint32_t indexedLeaves = 0;
+		uint64_t indexedRequestedBytes = 0;
+		for (QHash<uint32_t, uint32_t>::const_iterator named = namedBlocks.constBegin(); named != namedBlocks.constEnd(); ++named)
+		{
+			QVector<uint32_t> blocks = tailBlocks.value(named.key());
+			blocks.prepend(named.value());
+			foreach (uint32_t index, blocks)
+			{
+				if (index >= (uint32_t)nodes.size() || !isReached.at(index) || nodes.at(index).getProcId() != named.key()) {
+					problem = QString("process %1 is indexed to node %2 of another owner").arg(names->getName(named.key())).arg(index);
+					throw QResult_IncorrectData;
+				}
+			}
+			if (!requestedSizes.contains(named.key())) {
+				problem = QString("process %1 has no requested size").arg(names->getName(named.key()));
+				throw QResult_IncorrectData;
+			}
+			indexedLeaves += blocks.size();
+			indexedRequestedBytes += requestedSizes.value(named.key());
+		}
+		foreach (uint32_t procId, tailBlocks.keys())
+		{
+			if (!namedBlocks.contains(procId)) {
+				problem = QString("tail of process %1 has no first block").arg(names->getName(procId));
+				throw QResult_IncorrectData;
+			}
+		}
+		if (indexedLeaves != allocatedLeaves || requestedSizes.size() != namedBlocks.size()) {
+			problem = "allocated blocks and the name index differ";
+			throw QResult_IncorrectData;
+		}
+		if (allocatedBytes != grantedBytes || indexedRequestedBytes != requestedBytes) {
+			problem = "granted or requested bytes differ from the allocated blocks";
+			throw QResult_IncorrectData;
+		}
+	} catch (QResultStatus resultStatus) {
+		if (violation != nullptr)
+		{
+			*violation = problem;
+		}
+		return resultStatus;
+	}
+	return QResult_Success;
+}
+
+QString Memory::failureToString(const FailureReason reason)
+{
+	switch (reason)
+	{
+		case FailureReason::None:
+			return "";
+		case FailureReason::InvalidName:
+			return "invalid name";
+		case FailureReason::DuplicateName:
+			return "duplicate name";
+		case FailureReason::TooLarge:
+			return "larger than memory";
+		case FailureReason::OutOfMemory:
+			return "no free block";
+		case FailureReason::NotAllocated:
+			return "not allocated";
+		case FailureReason::SizeMismatch:
+			return "size differs from the cache";
+		case FailureReason::SlabPage:
+			return "page of a slab";
+		default:
+			return "unknown";
+	}
+}
+
+uint32_t Memory::findFreeInPair(const uint8_t rowIndex, const uint32_t slot) const
+{
+	if (nodes.at(slot).isFree())
+	{
+		return slot;
+	}
+	if (rowIndex != 0 && nodes.at(slot + 1).isFree())
+	{
+		return slot + 1;
+	}
+	return Block::NO_BLOCK;
+}
+
+uint32_t Memory::findFreeBlock(const uint8_t rowIndex)
+{
+	// no free block is large enough, nothing to search
+	if (nodes.at(ROOT).getLongestFreeDegree() < totalDegree - rowIndex)
+	{
+		return Block::NO_BLOCK;
+	}
+
+	uint32_t freeBlock = Block::NO_BLOCK;
+	if (hugePageClustering && rowIndex == totalDegree - minDegree)
+	{
+		// the smallest blocks fill regions in use before they break a free one
+		freeBlock = findInUsedRegion(rowIndex);
+	}
+
+	if (freeBlock != Block::NO_BLOCK)
+	{
+		return freeBlock;
+	}
+
+	if (policy == PlacementPolicy::FirstFound)
+	{
+		if (freeCounts.at(rowIndex) != 0)
+		{
+			foreach (uint32_t slot, levels.at(rowIndex))
+			{
+				freeBlock = findFreeInPair(rowIndex, slot);
+				if (freeBlock != Block::NO_BLOCK) break;
+			}
+		}
+
+		if (freeBlock == Block::NO_BLOCK)
+		{
+			// then we must spit blocks until the needed level
+			freeBlock = splitUntilDegree(rowIndex);
+		}
+	}
+	else if (policy == PlacementPolicy::LowestAddress || policy == PlacementPolicy::HighestAddress)
+	{
+		freeBlock = findAtEdge(rowIndex, policy == PlacementPolicy::LowestAddress);
+	}
+	else
+	{
+		freeBlock = findByPolicy(rowIndex);
+	}
+	return freeBlock;
+}
+
+uint32_t Memory::splitUntilDegree(const uint8_t degree)
+{
+	MEMORY_TRACE_SCOPE("Memory::splitUntilDegree");
+	// looking for the last level with free blocks
+	int16_t splitLevel = degree - 1;
+	uint32_t freeBlock = Block::NO_BLOCK;
+	for (; splitLevel >= 0; --splitLevel)
+	{
+		if (freeCounts.at(splitLevel) == 0) continue;
+		foreach (uint32_t slot, levels.at(splitLevel))
+		{
+			freeBlock = findFreeInPair(splitLevel, slot);
+			if (freeBlock != Block::NO_BLOCK) break;
+		}
+		if (freeBlock != Block::NO_BLOCK) break;
+	}
+	// begins splitting
+	if (freeBlock != Block::NO_BLOCK)
+	{
+		for (; splitLevel != degree; ++splitLevel)
+		{
+			uint32_t slot = split(freeBlock);
+			if (slot == Block::NO_BLOCK)
+			{
+				freeBlock = Block::NO_BLOCK;
+				break;
+			}
+			freeBlock = slot;
+		}
+	}
+	return freeBlock;
+}
+
+uint32_t Memory::findByPolicy(const uint8_t rowIndex)
+{
+	uint64_t address = 0;
+	if (policy == PlacementPolicy::HighestAddress)
+	{
+		address = UINT64_MAX;
+	}
+	else if (policy == PlacementPolicy::RecentlyFreed)
+	{
+		address = lastFreedAddress;
+	}
+	bool isSmallestFirst = (policy == PlacementPolicy::BestFit || policy == PlacementPolicy::RecentlyFreed);
+
+	// looking for the block nearest to the preferred address, smaller blocks win ties
+	uint32_t freeBlock = Block::NO_BLOCK;
+	uint64_t distance = UINT64_MAX;
+	for (int16_t level = rowIndex; level >= 0; --level)
+	{
+		uint32_t index = findNearestFree(level, address);
+		if (index == Block::NO_BLOCK) continue;
+
+		uint64_t indexDistance = getDistance(nodes.at(index).getDegree(), nodes.at(index).getPosition(), address);
+		if (freeBlock == Block::NO_BLOCK || indexDistance < distance)
+		{
+			freeBlock = index;
+			distance = indexDistance;
+		}
+		if (isSmallestFirst) break;
+	}
+
+	// splitting toward the preferred address
+	while (freeBlock != Block::NO_BLOCK && nodes.at(freeBlock).getDegree() > totalDegree - rowIndex)
+	{
+		uint32_t slot = split(freeBlock);
+		if (slot == Block::NO_BLOCK)
+		{
+			return Block::NO_BLOCK;
+		}
+		const Block& child = nodes.at(slot);
+		uint64_t rightDistance = getDistance(child.getDegree(), child.getPosition() + 1, address);
+		freeBlock = (rightDistance < getDistance(child.getDegree(), child.getPosition(), address) ? slot + 1 : slot);
+	}
+	return freeBlock;
+}
+
+uint32_t Memory::findInUsedRegion(const uint8_t rowIndex)
+{
+	uint64_t address = 0;
+	if (policy == PlacementPolicy::HighestAddress)
+	{
+		address = UINT64_MAX;
+	}
+	else if (policy == PlacementPolicy::RecentlyFreed)
+	{
+		address = lastFreedAddress;
+	}
+
+	// a free block smaller than a region lies in a region which is split, so in one in use
+	uint32_t freeBlock = Block::NO_BLOCK;
+	for (int16_t level = rowIndex; level > totalDegree - getRegionDegree() && freeBlock == Block::NO_BLOCK; --level)
+	{
+		if (freeCounts.at(level) == 0) continue;
+		if (policy == PlacementPolicy::FirstFound)
+		{
+			foreach (uint32_t slot, levels.at(level))
+			{
+				freeBlock = findFreeInPair(level, slot);
+				if (freeBlock != Block::NO_BLOCK) break;
+			}
+		}
+		else
+		{
+			freeBlock = findNearestFree(level, address);
+		}
+	}
+
+	// splitting toward the preferred address
+	while (freeBlock != Block::NO_BLOCK && nodes.at(freeBlock).getDegree() > totalDegree - rowIndex)
+	{
+		uint32_t slot = split(freeBlock);
+		if (slot == Block::NO_BLOCK)
+		{
+			return Block::NO_BLOCK;
+		}
+		const Block& child = nodes.at(slot);
+		uint64_t rightDistance = getDistance(child.getDegree(), child.getPosition() + 1, address);
+		freeBlock = (rightDistance < getDistance(child.getDegree(), child.getPosition(), address) ? slot + 1 : slot);
+	}
+	return freeBlock;
+}
+
+uint8_t Memory::getRegionDegree() const
+{
+	return qMin<uint8_t>(totalDegree, BackingStore::HUGE_PAGE_DEGREE);
+}
+
+uint32_t Memory::findNearestFree(const uint8_t rowIndex, const uint64_t address) const
+{
+	const FreeBitmap& blocks = freeBlocks.at(rowIndex);
+	uint8_t degree = totalDegree - rowIndex;
+	uint32_t position = qMin<uint64_t>(address >> degree, FreeBitmap::NOT_FOUND - 1);
+
+	// the nearest free blocks on both sides of the address
+	uint32_t next = blocks.findNext(position);
+	uint32_t previous = blocks.findPrevious(position);
+	if (previous == FreeBitmap::NOT_FOUND && next == FreeBitmap::NOT_FOUND)
+	{
+		return Block::NO_BLOCK;
+	}
+	if (next == FreeBitmap::NOT_FOUND ||
+			(previous != FreeBitmap::NOT_FOUND && getDistance(degree, previous, address) <= getDistance(degree, next, address)))
+	{
+		return findNode(rowIndex, previous);
+	}
+	return findNode(rowIndex, next);
+}
+
+uint32_t Memory::findNode(const uint8_t rowIndex, const uint32_t position) const
+{
+	// bits of the position choose the child from the root down
+	uint32_t index = ROOT;
+	for (uint8_t level = 1; level <= rowIndex && index != Block::NO_BLOCK; ++level)
+	{
+		uint32_t slot = nodes.at(index).getFirstChild();
+		index = (slot == Block::NO_BLOCK ? slot : slot + ((position >> (rowIndex - level)) & 1));
+	}
+	return index;
+}
+
+uint64_t Memory::getDistance(const uint8_t degree, const uint32_t position, const uint64_t address)
+{
+	uint64_t beginAddress = uint64_t(position) << degree;
+	uint64_t endAddress = beginAddress + MemorySettings::degreeToBytes(degree);
+	if (address < beginAddress)
+	{
+		return beginAddress - address;
+	}
+	if (address >= endAddress)
+	{
+		return address - endAddress + 1;
+	}
+	return 0;
+}
+
+void Memory::addFreeBlock(const uint32_t index)
+{
+	const Block& block = nodes.at(index);
+	uint8_t rowIndex = totalDegree - block.getDegree();
+	freeCounts[rowIndex]++;
+	if (policy != PlacementPolicy::FirstFound)
+	{
+		freeBlocks[rowIndex].set(block.getPosition());
+	}
+	updateLongestFree(index);
+}
+
+void Memory::removeFreeBlock(const uint32_t index)
+{
+	const Block& block = nodes.at(index);
+	uint8_t rowIndex = totalDegree - block.getDegree();
+	freeCounts[rowIndex]--;
+	if (policy != PlacementPolicy::FirstFound)
+	{
+		freeBlocks[rowIndex].reset(block.getPosition());
+	}
+	updateLongestFree(index);
+}
+
+void Memory::updateLongestFree(uint32_t index)
+{
+	// ancestors depend only on their children, so the walk stops at the first unchanged node
+	while (index != Block::NO_BLOCK)
+	{
+		Block& block = nodes[index];
+		uint8_t longestFree = 0;
+		if (block.hasChilds())
+		{
+			longestFree = qMax(nodes.at(block.childFirst).longestFree, nodes.at(block.childFirst + 1).longestFree);
+		}
+		else if (block.procId == NameTable::NO_NAME)
+		{
+			longestFree = block.sizeDegree + 1;
+		}
+
+		if (block.longestFree == longestFree) break;
+		block.longestFree = longestFree;
+		index = block.parent;
+	}
+}
+
+uint32_t Memory::findAtEdge(const uint8_t rowIndex, const bool isLowest)
+{
+	// descending to the leftmost or rightmost free block which is large enough
+	uint8_t neededLongest = totalDegree - rowIndex + 1;
+	uint32_t index = ROOT;
+	while (nodes.at(index).hasChilds())
+	{
+		uint32_t slot = nodes.at(index).getFirstChild();
+		uint32_t preferred = (isLowest ? slot : slot + 1);
+		index = (nodes.at(preferred).longestFree >= neededLongest ? preferred : (isLowest ? slot + 1 : slot));
+	}
+
+	// and splitting toward the same edge
+	while (index != Block::NO_BLOCK && nodes.at(index).getDegree() > totalDegree - rowIndex)
+	{
+		uint32_t slot = split(index);
+		index = (slot == Block::NO_BLOCK ? slot : (isLowest ? slot : slot + 1));
+	}
+	return index;
+}
+
+uint32_t Memory::split(const uint32_t index)
+{
+	MEMORY_TRACE_SCOPE("Memory::split");
+	if (nodes.at(index).hasChilds() || nodes.at(index).getDegree() == minDegree)
+	{
+		return Block::NO_BLOCK;
+	}
+
+	uint32_t slot = 0;
+	bool isPoolGrown = freeSlots.isEmpty();
+	if (isPoolGrown)
+	{
+		slot = nodes.size();
+		nodes.resize(slot + 2);
+	}
+	else
+	{
+		slot = freeSlots.takeLast();
+	}
+
+	// references are taken after resize, the pool may have been moved
+	Block& block = nodes[index];
+	uint8_t childDegree = block.getDegree() - 1;
+	nodes[slot] = Block(childDegree, index, block.getPosition() * 2);
+	nodes[slot + 1] = Block(childDegree, index, block.getPosition() * 2 + 1);
+	block.childFirst = slot;
+	// the parent is updated after it got its children
+	removeFreeBlock(index);
+	addFreeBlock(slot);
+	addFreeBlock(slot + 1);
+
+	levels[totalDegree - childDegree].push_back(slot);
+	++splitsCount;
+
+	if (isUndoEnabled)
+	{
+		logUndo(UndoOp::Split, index, slot);
+		undoLog.last().isPoolGrown = isPoolGrown;
+	}
+	return slot;
+}
+
+void Memory::splitTail(uint32_t index, uint64_t size, QVector<uint32_t>* blocks)
+{
+	// halves wholly covered by the size are taken, the half with the rest of it is split further
+	while (size < MemorySettings::degreeToBytes(nodes.at(index).getDegree()))
+	{
+		uint64_t halfSize = MemorySettings::degreeToBytes(nodes.at(index).getDegree() - 1);
+		uint32_t slot = split(index);
+		if (size > halfSize)
+		{
+			blocks->push_back(slot);
+			size -= halfSize;
+			index = slot + 1;
+		}
+		else
+		{
+			index = slot;
+		}
+	}
+	blocks->push_back(index);
+}
+
+void Memory::mergeChilds(const uint32_t index)
+{
+	MEMORY_TRACE_SCOPE("Memory::mergeChilds");
+	Block& block = nodes[index];
+	uint32_t slot = block.getFirstChild();
+	if (slot != Block::NO_BLOCK && nodes.at(slot).isFree() && nodes.at(slot + 1).isFree())
+	{
+		removeFreeBlock(slot);
+		removeFreeBlock(slot + 1);
+		block.childFirst = Block::NO_BLOCK;
+		freeSlots.push_back(slot);
+		addFreeBlock(index);
+
+		uint8_t rowIndex = totalDegree - block.getDegree();
+		int levelPosition = levels.at(rowIndex + 1).indexOf(slot);
+		levels[rowIndex + 1].remove(levelPosition);
+		++mergesCount;
+
+		if (isUndoEnabled)
+		{
+			logUndo(UndoOp::Merge, index, slot);
+			undoLog.last().levelPosition = levelPosition;
+		}
+	}
+}
+
+QResultStatus Memory::freeBlock(const uint32_t index)
+{
+	bool wasAllocated = nodes.at(index).getProcId() != NameTable::NO_NAME;
+	QResultStatus resultStatus = nodes[index].free();
+	if (resultStatus != QResult_Success)
+	{
+		return resultStatus;
+	}
+	if (wasAllocated)
+	{
+		addFreeBlock(index);
+	}
+
+	if (coalescingMode == CoalescingMode::LazyCoalescing)
+	{
+		deferredFrees.push_back(index);
+		logUndo(UndoOp::Defer, index);
+	}
+	else
+	{
+		mergeWithBuddy(index);
+	}
+	return resultStatus;
+}
+
+void Memory::mergeWithBuddy(const uint32_t index)
+{
+	if (index == ROOT)
+	{
+		return;
+	}
+
+	// trying to merge
+	uint32_t parent = nodes.at(index).getParent();
+	uint32_t slot = nodes.at(parent).getFirstChild();
+	uint32_t neighbour = (index == slot ? slot + 1 : slot);
+	if (nodes.at(neighbour).isFree())
+	{
+		mergeChilds(parent);
+		mergeWithBuddy(parent);
+	}
+}
+
+void Memory::logUndo(const UndoOp::Type type, const uint32_t index, const uint32_t slot,
+					 const uint32_t procId, const uint64_t bytes)
+{
+	if (!isUndoEnabled) return;
+
+	UndoOp op;
+	op.type = type;
+	op.isPoolGrown = false;
+	op.index = index;
+	op.slot = slot;
+	op.levelPosition = 0;
+	op.procId = procId;
+	op.bytes = bytes;
+	op.lastFreedAddress = lastFreedAddress;
+	undoLog.push_back(op);
+}
+
+void Memory::undo(const UndoOp& op)
+{
+	Block& block = nodes[op.index];
+	uint8_t rowIndex = totalDegree - block.getDegree();
+	switch (op.type)
+	{
+		case UndoOp::Split:
+			removeFreeBlock(op.slot);
+			removeFreeBlock(op.slot + 1);
+			block.childFirst = Block::NO_BLOCK;
+			addFreeBlock(op.index);
+			// the pair was the last one added to its level
+			levels[rowIndex + 1].removeLast();
+			--splitsCount;
+			if (op.isPoolGrown)
+			{
+				nodes.resize(nodes.size() - 2);
+			}
+			else
+			{
+				freeSlots.push_back(op.slot);
+			}
+			break;
+		case UndoOp::Merge:
+		{
+			// the pair goes back to the same slot, which was the last one released
+			freeSlots.removeLast();
+			uint32_t position = block.getPosition();
+			uint8_t childDegree = block.getDegree() - 1;
+			block.childFirst = op.slot;
+			nodes[op.slot] = Block(childDegree, op.index, position * 2);
+			nodes[op.slot + 1] = Block(childDegree, op.index, position * 2 + 1);
+			removeFreeBlock(op.index);
+			addFreeBlock(op.slot);
+			addFreeBlock(op.slot + 1);
+			levels[rowIndex + 1].insert(op.levelPosition, op.slot);
+			--mergesCount;
+			break;
+		}
+		case UndoOp::Assign:
+			block.procId = NameTable::NO_NAME;
+			// the tail was assigned after the first block
+			if (tailBlocks.contains(op.procId))
+			{
+				QVector<uint32_t>& tail = tailBlocks[op.procId];
+				tail.removeLast();
+				if (tail.isEmpty())
+				{
+					tailBlocks.remove(op.procId);
+				}
+			}
+			else
+			{
+				namedBlocks.remove(op.procId);
+				requestedSizes.remove(op.procId);
+			}
+			addFreeBlock(op.index);
+			requestedBytes -= op.bytes;
+			grantedBytes -= MemorySettings::degreeToBytes(block.getDegree());
+			break;
+		case UndoOp::Release:
+			block.procId = op.procId;
+			// the first block was released after the tail
+			if (namedBlocks.contains(op.procId))
+			{
+				tailBlocks[op.procId].push_back(op.index);
+			}
+			else
+			{
+				namedBlocks.insert(op.procId, op.index);
+				requestedSizes.insert(op.procId, op.bytes);
+			}
+			removeFreeBlock(op.index);
+			lastFreedAddress = op.lastFreedAddress;
+			requestedBytes += op.bytes;
+			grantedBytes += MemorySettings::degreeToBytes(block.getDegree());
+			break;
+		case UndoOp::Defer:
+			deferredFrees.removeLast();
+			break;
+		case UndoOp::Undefer:
+			// blocks are taken from the end, so reverting puts them back in the same order
+			deferredFrees.push_back(op.index);
+			break;
+	}
+}
+
+QResultStatus Memory::memToDot(QString* result)
+{
+	try {
+		// if no nodes
+		if (levels.size() == 0) {
+			throw QResult_ActionUnavailable;
+		}
+		*result = "digraph Memory{\n";
+		for (uint8_t rowIndex = 0; rowIndex < levels.size(); ++rowIndex)
+		{
+			foreach (uint32_t slot, levels.at(rowIndex))
+			{
+				for (uint32_t index = slot; index < slot + (rowIndex == 0 ? 1 : 2); ++index)
+				{
+					const Block& block = nodes.at(index);
+					uint8_t degree = block.getDegree();
+					QString label = MemorySettings::degreeToString(degree);
+					result->append(QString("%1 ").arg(QString::number(index)));
+					if (!block.isFree())
+					{
+						QString code = "";
+						if (block.getProcId() != NameTable::NO_NAME)
+						{
+							QString procName = names->getName(block.getProcId());
+							QString color = Block::getColor(procName).name();
+							code = QString(" [label=\"%1 = %2\", color=\"%3\", fontcolor=\"#000000\", style=filled];\n").arg(procName, label, color);
+						}
+						else
+						{
+							code = QString(" [label=\"%1\", color=\"#e0e0e0\", fontcolor=\"#000000\", style=filled];\n").arg(label);
+						}
+						result->append(code);
+					}
+					else
+					{
+						QString code = QString(" [label=\"%1\"];").arg(label);
+						result->append(code);
+					}
+					// adding link from parent
+					if (block.getParent() != Block::NO_BLOCK)
+					{
+						QString code = QString("%1 -> %2;\n").arg(QString::number(block.getParent()), QString::number(index));
+						result->append(code);
 					}
 				}
 			}
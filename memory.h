@@ -6,6 +6,8 @@
 #include <QPair>
 #include <QVector>
 #include <QSet>
+#include <QHash>
+#include <QByteArray>
 #include <QFile>
 #include <QObject>
 #include <QTextStream>
@@ -21,32 +23,180 @@ QT_CHARTS_USE_NAMESPACE
 #include "common.h"
 #include "memory_settings.h"
 #include "block.h"
+#include "name_table.h"
+#include "free_bitmap.h"
+#include "backing_store.h"
+
+enum class FailureReason
+{
+	None,
+	InvalidName,
+	DuplicateName,
+	TooLarge,
+	OutOfMemory,
+	NotAllocated,
+	/// Object of another size than the objects of its cache.
+	SizeMismatch,
+	/// Plain free of a page which a slab holds.
+	SlabPage
+};
+
+/// Huge page sized regions of memory by use, memory smaller than a huge page is one region.
+struct HugePageUsage
+{
+	uint32_t freeCount;
+	uint32_t partialCount;
+	uint32_t fullCount;
+};
+
+/// Change of memory which can be reverted.
+struct UndoOp
+{
+	enum Type : uint8_t
+	{
+		Split,
+		Merge,
+		Assign,
+		Release,
+		/// A freed block was put aside for lazy coalescing.
+		Defer,
+		/// A put aside block was taken for coalescing.
+		Undefer
+	};
+
+	Type type;
+	/// Set when the split pair was appended to the pool instead of reusing a free slot.
+	bool isPoolGrown;
+	uint32_t index;
+	uint32_t slot;
+	/// Place of the merged pair in its level.
+	uint32_t levelPosition;
+	uint32_t procId;
+	uint64_t bytes;
+	/// Address of the last freed block before a release.
+	uint64_t lastFreedAddress;
+};
 
 class Memory
 {
 	public:
-		typedef QPair<Block*, Block*> pair_t;
-		typedef QVector<pair_t*> level_t;
-		typedef QVector<level_t*> tree_t;
+		/// Slots of children pairs placed on one level, the root level holds the root alone.
+		typedef QVector<uint32_t> level_t;
+		typedef QVector<level_t> tree_t;
 		~Memory();
-		Memory(MemorySettings* settings);
+		Memory(MemorySettings* settings, NameTable* names);
 
-		QResultStatus allocate(const uint64_t bytes, const QString& procName);
-		QResultStatus free(const QString& procName);
-		QString query(const QString& procName);
+		QResultStatus allocate(const uint64_t bytes, const uint32_t procId);
+		/// Allocation with the degree of the bytes known beforehand, as given by MemorySettings::bytesToDegree().
+		QResultStatus allocate(const uint64_t bytes, const uint32_t procId, uint8_t searchedDegree);
+		QResultStatus free(const uint32_t procId);
+		QString query(const uint32_t procId);
+		/// Begin address of the first block of the process, UINT64_MAX when it is not allocated.
+		uint64_t getBeginAddress(const uint32_t procId) const;
+		/// Bytes granted to the process including its tail, zero when it is not allocated.
+		uint64_t getBlockSize(const uint32_t procId) const;
+		/// Maps real memory of the total size, so blocks of processes get pointers at their addresses.
+		QResultStatus setBackingEnabled(bool value, const PageMode mode = PageMode::Regular);
+		/// Pages the backing got, regular ones without backing.
+		PageMode getBackingPageMode() const;
+		/// Bytes of the backing on huge pages at the moment.
+		uint64_t getBackingHugePageBytes() const;
+		HugePageUsage getHugePageUsage() const;
+		/// Pointer to the first block of the process, nullptr without backing or when it is not allocated.
+		uint8_t* getPointer(const uint32_t procId) const;
 		QResultStatus toSvg(const QString& pathToFile);
 		QChartView* toChart();
 		void clear();
 		void recalculateInfo();
+		uint32_t getNodesCount() const;
+		QResultStatus saveState(QByteArray* state) const;
+		QResultStatus loadState(const QByteArray& state);
+		void setUndoEnabled(bool value);
+		void clearUndoLog();
+		uint32_t getUndoOpsCount() const;
+		QResultStatus undoTo(const uint32_t opsCount);
+
+		uint8_t getTotalDegree() const;
+		uint8_t getMinDegree() const;
+		uint32_t getFreeCount(const uint8_t degree) const;
+		int16_t getLargestFreeDegree() const;
+		uint64_t getSplitsCount() const;
+		uint64_t getMergesCount() const;
+		uint32_t getDeferredCount() const;
+		void coalesce();
+		uint64_t getFreeBytes() const;
+		uint64_t getRequestedBytes() const;
+		uint64_t getGrantedBytes() const;
+		FailureReason getLastFailure() const;
+		/// Verifies the tree, free lists and name index against each other, the first violation is described.
+		QResultStatus checkInvariants(QString* violation = nullptr) const;
+		static QString failureToString(const FailureReason reason);
 
 	private:
+		static const uint32_t ROOT = 0;
+
 		MemorySettings* settings;
-		tree_t* blocks;
-		pair_t* rootPair;
+		NameTable* names;
+		uint8_t totalDegree;
+		uint8_t minDegree;
+		/// Pool of tree nodes, children of a node always occupy two neighbouring slots.
+		QVector<Block> nodes;
+		/// First slots of released children pairs which can be reused.
+		QVector<uint32_t> freeSlots;
+		tree_t levels;
+		/// Index of allocated blocks by process id.
+		QHash<uint32_t, uint32_t> namedBlocks;
+		/// Bytes requested by each process, the granted size is known from its block.
+		QHash<uint32_t, uint64_t> requestedSizes;
+		/// Blocks following the first one of processes granted a run of blocks, by address.
+		QHash<uint32_t, QVector<uint32_t> > tailBlocks;
+		bool tailTrimming;
+		bool hugePageClustering;
+		/// Quantity of free blocks on each level.
+		QVector<uint32_t> freeCounts;
+		PlacementPolicy policy;
+		/// Free blocks of each level by position, kept for policies other than FirstFound.
+		QVector<FreeBitmap> freeBlocks;
+		uint64_t lastFreedAddress;
+		CoalescingMode coalescingMode;
+		uint32_t coalescingWatermark;
+		/// Freed blocks not yet merged with their buddies, the newest is the last.
+		QVector<uint32_t> deferredFrees;
+		uint64_t splitsCount;
+		uint64_t mergesCount;
+		uint64_t requestedBytes;
+		uint64_t grantedBytes;
+		FailureReason lastFailure;
+		bool isUndoEnabled;
+		/// Real memory behind the addresses, nullptr unless backing is enabled.
+		BackingStore* backing;
+		/// Pages requested for the backing, kept to map it again for another size.
+		PageMode backingPageMode;
+		/// Changes made since the log was enabled or cleared, the newest is the last.
+		QVector<UndoOp> undoLog;
 
 		Memory();
-		Block* splitUntilDegree(const uint8_t degree);
-		QResultStatus free(Block* block);
+		void logUndo(const UndoOp::Type type, const uint32_t index, const uint32_t slot = 0,
+					 const uint32_t procId = NameTable::NO_NAME, const uint64_t bytes = 0);
+		void undo(const UndoOp& op);
+		uint32_t findFreeInPair(const uint8_t rowIndex, const uint32_t slot) const;
+		uint32_t findFreeBlock(const uint8_t rowIndex);
+		uint32_t splitUntilDegree(const uint8_t degree);
+		void splitTail(uint32_t index, uint64_t size, QVector<uint32_t>* blocks);
+		uint32_t findByPolicy(const uint8_t rowIndex);
+		uint32_t findInUsedRegion(const uint8_t rowIndex);
+		uint8_t getRegionDegree() const;
+		uint32_t findNearestFree(const uint8_t rowIndex, const uint64_t address) const;
+		uint32_t findNode(const uint8_t rowIndex, const uint32_t position) const;
+		static uint64_t getDistance(const uint8_t degree, const uint32_t position, const uint64_t address);
+		void addFreeBlock(const uint32_t index);
+		void removeFreeBlock(const uint32_t index);
+		void updateLongestFree(uint32_t index);
+		uint32_t findAtEdge(const uint8_t rowIndex, const bool isLowest);
+		uint32_t split(const uint32_t index);
+		void mergeChilds(const uint32_t index);
+		QResultStatus freeBlock(const uint32_t index);
+		void mergeWithBuddy(const uint32_t index);
 		QResultStatus memToDot(QString* result);
 		QResultStatus dotToSvg(const QString& pathToFile);
 };
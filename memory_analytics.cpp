@@ -0,0 +1,146 @@
+#include "memory_analytics.h"
+
+MemoryAnalytics::MemoryAnalytics() :
+	totalDegree(0),
+	levelsCount(0)
+{
+
+}
+
+void MemoryAnalytics::record(const Memory* mem, const uint32_t cmdIndex, const char action, const uint32_t procId,
+							 const uint64_t requestedBytes, const QResultStatus status, const FailureReason failure)
+{
+	if (steps.isEmpty())
+	{
+		totalDegree = mem->getTotalDegree();
+		levelsCount = mem->getTotalDegree() + 1 - mem->getMinDegree();
+	}
+
+	Step step;
+	step.cmdIndex = cmdIndex;
+	step.action = action;
+	step.procId = procId;
+	step.requestedBytes = requestedBytes;
+	step.status = status;
+	step.failure = (status == QResult_Success ? FailureReason::None : failure);
+	step.liveRequestedBytes = mem->getRequestedBytes();
+	step.liveGrantedBytes = mem->getGrantedBytes();
+	step.freeBytes = mem->getFreeBytes();
+	step.largestFreeDegree = mem->getLargestFreeDegree();
+	steps.push_back(step);
+
+	for (uint8_t rowIndex = 0; rowIndex < levelsCount; ++rowIndex)
+	{
+		freeCounts.push_back(mem->getFreeCount(totalDegree - rowIndex));
+	}
+}
+
+void MemoryAnalytics::clear()
+{
+	steps.clear();
+	freeCounts.clear();
+}
+
+void MemoryAnalytics::truncate(const uint32_t stepsCount)
+{
+	if (stepsCount < (uint32_t)steps.size())
+	{
+		steps.resize(stepsCount);
+		freeCounts.resize(stepsCount * levelsCount);
+	}
+}
+
+uint32_t MemoryAnalytics::getStepsCount() const
+{
+	return steps.size();
+}
+
+const MemoryAnalytics::Step& MemoryAnalytics::getStep(const uint32_t index) const
+{
+	return steps.at(index);
+}
+
+uint32_t MemoryAnalytics::getFreeCount(const uint32_t index, const uint8_t degree) const
+{
+	if (degree > totalDegree || totalDegree - degree >= levelsCount)
+	{
+		return 0;
+	}
+	return freeCounts.at(index * levelsCount + totalDegree - degree);
+}
+
+uint32_t MemoryAnalytics::getFailuresCount(const FailureReason reason) const
+{
+	uint32_t count = 0;
+	foreach (const Step& step, steps)
+	{
+		if (step.status != QResult_Success && step.failure == reason)
+		{
+			++count;
+		}
+	}
+	return count;
+}
+
+double MemoryAnalytics::internalFragmentation(const Step& step)
+{
+	// share of granted bytes which were not requested
+	if (step.liveGrantedBytes == 0)
+	{
+		return 0;
+	}
+	return double(step.liveGrantedBytes - step.liveRequestedBytes) / double(step.liveGrantedBytes);
+}
+
+double MemoryAnalytics::externalFragmentation(const Step& step)
+{
+	// share of free bytes which cannot be served by the largest free block
+	if (step.freeBytes == 0 || step.largestFreeDegree < 0)
+	{
+		return 0;
+	}
+	return 1.0 - double(MemorySettings::degreeToBytes(step.largestFreeDegree)) / double(step.freeBytes);
+}
+
+QResultStatus MemoryAnalytics::toCsv(const QString& pathToFile, const NameTable* names) const
+{
+	QFile file(pathToFile);
+	if (!file.open(QFile::WriteOnly | QFile::Text)) {
+		return QResult_UnexpectedError;
+	}
+
+	QTextStream wfstream(&file);
+	wfstream << "step,command,action,name,requested,status,failure,live_requested,live_granted,"
+				"internal_fragmentation,free_bytes,largest_free,external_fragmentation";
+	for (uint8_t rowIndex = 0; rowIndex < levelsCount; ++rowIndex)
+	{
+		wfstream << ",free_" << MemorySettings::degreeToString(totalDegree - rowIndex);
+	}
+	wfstream << '\n';
+
+	for (uint32_t stepIndex = 0; stepIndex < (uint32_t)steps.size(); ++stepIndex)
+	{
+		const Step& step = steps.at(stepIndex);
+		uint64_t largestFree = (step.largestFreeDegree < 0 ? 0 : MemorySettings::degreeToBytes(step.largestFreeDegree));
+		// names may hold commas and quotes, so the field is quoted with its quotes doubled
+		QString name = names->getName(step.procId);
+		wfstream << stepIndex << ',' << step.cmdIndex << ',' << step.action << ','
+				 << '"' << name.replace("\"", "\"\"") << '"' << ',' << step.requestedBytes << ','
+				 << (step.status == QResult_Success ? "ok" : "failed") << ','
+				 << Memory::failureToString(step.failure) << ','
+				 << step.liveRequestedBytes << ',' << step.liveGrantedBytes << ','
+				 << QString::number(internalFragmentation(step), 'f', 4) << ','
+				 << step.freeBytes << ',' << largestFree << ','
+				 << QString::number(externalFragmentation(step), 'f', 4);
+		for (uint8_t rowIndex = 0; rowIndex < levelsCount; ++rowIndex)
+		{
+			wfstream << ',' << freeCounts.at(stepIndex * levelsCount + rowIndex);
+		}
+		wfstream << '\n';
+	}
+	wfstream.flush();
+	file.flush();
+	file.close();
+
+	return QResult_Success;
+}
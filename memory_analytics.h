@@ -0,0 +1,58 @@
+#ifndef MEMORY_ANALYTICS_H
+#define MEMORY_ANALYTICS_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+#include <QVector>
+#include <QFile>
+#include <QTextStream>
+
+#include "common.h"
+#include "memory.h"
+#include "name_table.h"
+
+/// Collects fragmentation statistics of Memory after every executed command.
+class MemoryAnalytics
+{
+	public:
+		/// State of memory sampled after one command.
+		struct Step
+		{
+			uint32_t cmdIndex;
+			char action;
+			uint32_t procId;
+			uint64_t requestedBytes;
+			QResultStatus status;
+			FailureReason failure;
+			uint64_t liveRequestedBytes;
+			uint64_t liveGrantedBytes;
+			uint64_t freeBytes;
+			int16_t largestFreeDegree;
+		};
+
+		MemoryAnalytics();
+
+		/// The failure is kept for commands which failed only.
+		void record(const Memory* mem, const uint32_t cmdIndex, const char action, const uint32_t procId,
+					const uint64_t requestedBytes, const QResultStatus status, const FailureReason failure);
+		void clear();
+		void truncate(const uint32_t stepsCount);
+		uint32_t getStepsCount() const;
+		const Step& getStep(const uint32_t index) const;
+		uint32_t getFreeCount(const uint32_t index, const uint8_t degree) const;
+		uint32_t getFailuresCount(const FailureReason reason) const;
+
+		static double internalFragmentation(const Step& step);
+		static double externalFragmentation(const Step& step);
+
+		QResultStatus toCsv(const QString& pathToFile, const NameTable* names) const;
+
+	private:
+		QVector<Step> steps;
+		/// Free blocks per level of every step, levelsCount values per step.
+		QVector<uint32_t> freeCounts;
+		uint8_t totalDegree;
+		uint8_t levelsCount;
+};
+
+#endif // MEMORY_ANALYTICS_H
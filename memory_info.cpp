@@ -4,3 +4,6 @@ QString MemoryInfo::usedMemory = "0B";
 uint64_t MemoryInfo::blocksQuantity = 0;
 QString MemoryInfo::smallestBlockSize = "NaN";
 double MemoryInfo::usedPercent = 1;
+QString MemoryInfo::allocateLatency = "no commands";
+QString MemoryInfo::freeLatency = "no commands";
+QString MemoryInfo::queryLatency = "no commands";
@@ -10,6 +10,9 @@ class MemoryInfo
 		static uint64_t blocksQuantity;
 		static QString smallestBlockSize;
 		static double usedPercent;
+		static QString allocateLatency;
+		static QString freeLatency;
+		static QString queryLatency;
 };
 
 #endif // MEMORY_INFO_H
@@ -1,19 +1,68 @@
 #include "memory_settings.h"
 
+#include <QtCore/qalgorithms.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 MemorySettings::MemorySettings()
 {
 	totalMemoryDegree = MAX_TOTAL_MEMORY_DEGREE;
 	minBlockDegree = 1;
 	stepsExecutionSpeed = 1.0;
 	autoSaveCmds = true;
+	autoSaveMode = AutoSaveMode::Debounced;
+	placementPolicy = PlacementPolicy::FirstFound;
+	coalescingMode = CoalescingMode::EagerCoalescing;
+	coalescingWatermark = 64;
+	tailTrimming = false;
+	hugePageClustering = false;
 }
 
 uint64_t MemorySettings::degreeToBytes(uint8_t degree)
 {
-	uint64_t bytes = 1;
-	for (bytes = 1; degree > 0; --degree)
-		bytes <<= 1;
-	return bytes;
+	return uint64_t(1) << degree;
+}
+
+uint8_t MemorySettings::bytesToDegree(uint64_t bytes)
+{
+	// zero and one byte take the block of degree 0, no leading zeros are counted for zero
+	return 64 - qCountLeadingZeroBits(quint64(bytes - (bytes != 0)));
+}
+
+void MemorySettings::bytesToDegrees(const uint64_t* bytes, uint8_t* degrees, uint32_t count)
+{
+	uint32_t index = 0;
+#ifdef __SSE2__
+	// two sizes per step: a size below 2^52 converted to a double carries floor(log2) in its exponent,
+	// the conversion adds the size to the bits of 2^52 and subtracts 2^52 as a double
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i ones = _mm_set1_epi32(-1);
+	const __m128i magicBits = _mm_set1_epi64x(0x4330000000000000LL);
+	const __m128d magic = _mm_castsi128_pd(magicBits);
+	const __m128i exponentBias = _mm_set1_epi16(1022);
+	for (; index + 2 <= count; index += 2)
+	{
+		__m128i sizes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + index));
+		// a size less one, zero stays zero, halves of a 64-bit lane are both zero for a zero lane
+		__m128i isZero = _mm_cmpeq_epi32(sizes, zero);
+		isZero = _mm_and_si128(isZero, _mm_shuffle_epi32(isZero, _MM_SHUFFLE(2, 3, 0, 1)));
+		__m128i values = _mm_add_epi64(sizes, _mm_andnot_si128(isZero, ones));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_srli_epi64(values, 52), zero)) != 0xffff) break;
+
+		__m128d converted = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(values, magicBits)), magic);
+		// the exponent of 2^k is 1023 + k, the block takes k + 1, zero converts to a zero exponent
+		__m128i result = _mm_subs_epu16(_mm_srli_epi64(_mm_castpd_si128(converted), 52), exponentBias);
+		degrees[index] = uint8_t(_mm_cvtsi128_si32(result));
+		degrees[index + 1] = uint8_t(_mm_cvtsi128_si32(_mm_srli_si128(result, 8)));
+	}
+#endif
+	// the odd size left, or all of them from a size too large for the conversion
+	for (; index < count; ++index)
+	{
+		degrees[index] = bytesToDegree(bytes[index]);
+	}
 }
 
 QResultStatus MemorySettings::setMinBlockDegree(uint8_t degree)
@@ -63,11 +112,50 @@ void MemorySettings::setAutoSaveCmds(bool value)
 	autoSaveCmds = value;
 }
 
+void MemorySettings::setAutoSaveMode(AutoSaveMode value)
+{
+	autoSaveMode = value;
+}
+
 void MemorySettings::setDrawUtility(DrawUtility value)
 {
 	drawUtility = value;
 }
 
+void MemorySettings::setPlacementPolicy(PlacementPolicy value)
+{
+	placementPolicy = value;
+}
+
+void MemorySettings::setCoalescingMode(CoalescingMode value)
+{
+	coalescingMode = value;
+}
+
+QResultStatus MemorySettings::setCoalescingWatermark(uint32_t value)
+{
+	QResultStatus resultStatus = QResult_Success;
+	if (value > 0 && value <= MAX_COALESCING_WATERMARK)
+	{
+		this->coalescingWatermark = value;
+	}
+	else
+	{
+		resultStatus = QResult_DataOutOfRange;
+	}
+	return resultStatus;
+}
+
+void MemorySettings::setTailTrimming(bool value)
+{
+	tailTrimming = value;
+}
+
+void MemorySettings::setHugePageClustering(bool value)
+{
+	hugePageClustering = value;
+}
+
 uint8_t MemorySettings::getMinBlockDegree()
 {
 	return minBlockDegree;
@@ -88,20 +176,46 @@ bool MemorySettings::getAutoSaveCmds()
 	return autoSaveCmds;
 }
 
+AutoSaveMode MemorySettings::getAutoSaveMode()
+{
+	return autoSaveMode;
+}
+
 DrawUtility MemorySettings::getDrawUtility()
 {
 	return drawUtility;
 }
 
-QString MemorySettings::degreeToString(uint8_t degree)
+PlacementPolicy MemorySettings::getPlacementPolicy()
 {
-	uint8_t divider = 0;
-	uint16_t bytes = 1;
-	QString result = QString("");
+	return placementPolicy;
+}
 
-	for (divider = 0; degree >= 10; degree -= 10 , ++divider);
+CoalescingMode MemorySettings::getCoalescingMode()
+{
+	return coalescingMode;
+}
+
+uint32_t MemorySettings::getCoalescingWatermark()
+{
+	return coalescingWatermark;
+}
 
-	bytes = (uint16_t)degreeToBytes(degree);
+bool MemorySettings::getTailTrimming()
+{
+	return tailTrimming;
+}
+
+bool MemorySettings::getHugePageClustering()
+{
+	return hugePageClustering;
+}
+
+QString MemorySettings::degreeToString(uint8_t degree)
+{
+	uint8_t divider = degree / 10;
+	uint16_t bytes = (uint16_t)degreeToBytes(degree % 10);
+	QString result = QString("");
 
 	switch (divider) {
 		case 0:
@@ -131,11 +245,10 @@ QString MemorySettings::degreeToString(uint8_t degree)
 
 QString MemorySettings::bytesToString(uint64_t bytes)
 {
-	uint8_t divider = 0;
+	// every unit is ten degrees of two
+	uint8_t divider = (bytes < 1024 ? 0 : (63 - qCountLeadingZeroBits(quint64(bytes))) / 10);
 	QString result = QString("");
-	double value = bytes;
-
-	for (divider = 0; value >= 1024; value /= 1024 , ++divider);
+	double value = double(bytes) / double(degreeToBytes(10 * divider));
 
 	switch (divider) {
 		case 0:
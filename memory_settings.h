@@ -16,14 +16,48 @@ enum DrawUtility
 	circo
 };
 
+enum AutoSaveMode
+{
+	Debounced,
+	Immediate
+};
+
+/// Choice of the free block for an allocation.
+enum PlacementPolicy
+{
+	/// The first free block in the order blocks were split.
+	FirstFound,
+	LowestAddress,
+	HighestAddress,
+	/// The smallest sufficient block, the lowest address among equal ones.
+	BestFit,
+	/// The smallest sufficient block nearest to the last freed one.
+	RecentlyFreed
+};
+
+/// When freed buddies are merged back.
+enum CoalescingMode
+{
+	EagerCoalescing,
+	/// Freed blocks are merged in a batch when their count reaches the watermark or an allocation fails.
+	LazyCoalescing
+};
+
 class MemorySettings
 {
 	public:
 		const uint8_t MAX_TOTAL_MEMORY_DEGREE = 30;
 		const double MAX_STEPS_EXECUTION_SPEED = 5.0;
+		/// Delay in milliseconds used to coalesce edits before autosaving.
+		const uint16_t AUTO_SAVE_DELAY = 1000;
+		const uint32_t MAX_COALESCING_WATERMARK = 1 << 20;
 
 		MemorySettings();
 		static uint64_t degreeToBytes(uint8_t degree);
+		/// Degree of the smallest power of two which holds the bytes.
+		static uint8_t bytesToDegree(uint64_t bytes);
+		/// bytesToDegree() over an array of sizes, two at a time with SSE2.
+		static void bytesToDegrees(const uint64_t* bytes, uint8_t* degrees, uint32_t count);
 		static QString degreeToString(uint8_t degree);
 		static QString bytesToString(uint64_t bytes);
 
@@ -31,20 +65,40 @@ class MemorySettings
 		QResultStatus setTotalMemoryDegree(uint8_t degree);
 		QResultStatus setStepsExecutionSpeed(double speed);
 		void setAutoSaveCmds(bool value);
+		void setAutoSaveMode(AutoSaveMode value);
 		void setDrawUtility(DrawUtility value);
+		void setPlacementPolicy(PlacementPolicy value);
+		void setCoalescingMode(CoalescingMode value);
+		QResultStatus setCoalescingWatermark(uint32_t value);
+		void setTailTrimming(bool value);
+		void setHugePageClustering(bool value);
 
 		uint8_t getMinBlockDegree();
 		uint8_t getTotalMemoryDegree();
 		double getStepsExecutionSpeed();
 		bool getAutoSaveCmds();
+		AutoSaveMode getAutoSaveMode();
 		DrawUtility getDrawUtility();
+		PlacementPolicy getPlacementPolicy();
+		CoalescingMode getCoalescingMode();
+		uint32_t getCoalescingWatermark();
+		bool getTailTrimming();
+		bool getHugePageClustering();
 
 	private:
 		uint8_t minBlockDegree;
 		uint8_t totalMemoryDegree;
 		double stepsExecutionSpeed;
 		bool autoSaveCmds;
+		AutoSaveMode autoSaveMode;
 		DrawUtility drawUtility;
+		PlacementPolicy placementPolicy;
+		CoalescingMode coalescingMode;
+		uint32_t coalescingWatermark;
+		/// Requests are granted a run of blocks instead of one rounded up to a power of two.
+		bool tailTrimming;
+		/// Blocks of the smallest degree are placed in huge page regions in use before free regions are split.
+		bool hugePageClustering;
 };
 
 #endif // MEMORY_SETTINGS_H
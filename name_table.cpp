@@ -0,0 +1,61 @@
+#include "name_table.h"
+
+const uint32_t NameTable::NO_NAME;
+
+NameTable::NameTable() :
+	uniqueNameCounter(0)
+{
+	// id 0 stands for the empty name
+	names.push_back("");
+}
+
+uint32_t NameTable::intern(const QString& name)
+{
+	if (name.length() == 0)
+	{
+		return NO_NAME;
+	}
+
+	QHash<QString, uint32_t>::const_iterator iter = ids.constFind(name);
+	if (iter != ids.constEnd())
+	{
+		return iter.value();
+	}
+
+	uint32_t id = names.size();
+	names.push_back(name);
+	ids.insert(name, id);
+	return id;
+}
+
+uint32_t NameTable::find(const QString& name) const
+{
+	return ids.value(name, NO_NAME);
+}
+
+QString NameTable::getName(const uint32_t id) const
+{
+	if (id >= (uint32_t)names.size())
+	{
+		return QString("");
+	}
+	return names.at(id);
+}
+
+QString NameTable::getUniqueName(const QString& prefix)
+{
+	// the counter only grows, so each name is probed once over the table lifetime
+	QString name = "";
+	do
+	{
+		name = QString("%1%2").arg(prefix, QString::number(uniqueNameCounter++));
+	}
+	while (ids.contains(name));
+
+	return name;
+}
+
+uint32_t NameTable::getCount() const
+{
+	return names.size() - 1;
+}
@@ -0,0 +1,32 @@
+#ifndef NAME_TABLE_H
+#define NAME_TABLE_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+#include "common.h"
+
+/// Interning table which maps process names to 32-bit ids.
+/// Id NO_NAME is reserved for "no process", so free blocks can be recognised by a plain compare.
+class NameTable
+{
+	public:
+		static const uint32_t NO_NAME = 0;
+
+		NameTable();
+
+		uint32_t intern(const QString& name);
+		uint32_t find(const QString& name) const;
+		QString getName(const uint32_t id) const;
+		QString getUniqueName(const QString& prefix = "P");
+		uint32_t getCount() const;
+
+	private:
+		QHash<QString, uint32_t> ids;
+		QVector<QString> names;
+		uint64_t uniqueNameCounter;
+};
+
+#endif // NAME_TABLE_H
@@ -0,0 +1,411 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "malloc_trace.h"
+
+/// Allocator calls of a program run with LD_PRELOAD=libCP_SSW_preload.so are captured into the file named
+/// by CP_SSW_MALLOC_TRACE, where %p stands for the process id, malloc-%p.trace by default.
+/// The capture tool turns it into a command file.
+/// Records are buffered per thread and written in chunks, the only shared state on a call is the sequence counter.
+/// Children of fork() are not traced, they would share the file and the sequence with the parent.
+
+namespace
+{
+	const uint32_t BUFFER_RECORDS = 4096;
+	const size_t BOOTSTRAP_SIZE = 8192;
+
+	typedef void* (*MallocFunction)(size_t);
+	typedef void (*FreeFunction)(void*);
+	typedef void* (*CallocFunction)(size_t, size_t);
+	typedef void* (*ReallocFunction)(void*, size_t);
+	typedef void* (*MemalignFunction)(size_t, size_t);
+	typedef int (*PosixMemalignFunction)(void**, size_t, size_t);
+
+	/// Records of one thread not yet written.
+	/// Only its thread fills it, the lock keeps it from the destructor of the library which writes it at exit.
+	struct ThreadBuffer
+	{
+		std::atomic<bool> isLocked;
+		/// Set at exit, records made afterwards are dropped.
+		bool isClosed;
+		uint32_t count;
+		uint32_t thread;
+		ThreadBuffer* previous;
+		ThreadBuffer* next;
+		MallocTraceRecord records[BUFFER_RECORDS];
+	};
+
+	MallocFunction realMalloc = nullptr;
+	FreeFunction realFree = nullptr;
+	CallocFunction realCalloc = nullptr;
+	ReallocFunction realRealloc = nullptr;
+	MemalignFunction realMemalign = nullptr;
+	MemalignFunction realAlignedAlloc = nullptr;
+	PosixMemalignFunction realPosixMemalign = nullptr;
+
+	pthread_mutex_t stateMutex = PTHREAD_MUTEX_INITIALIZER;
+	/// Set once the real functions are known, they are read without the mutex afterwards.
+	std::atomic<bool> isInitialized(false);
+	std::atomic<int> traceFile(-1);
+	std::atomic<uint64_t> sequence(0);
+	std::atomic<uint32_t> threadsCount(0);
+	/// Buffers of running threads, the ones still filled are written at exit.
+	ThreadBuffer* buffers = nullptr;
+	pthread_key_t bufferKey;
+
+	/// dlsym() allocates before the real functions are known, such requests are served from here and never freed.
+	char bootstrapArena[BOOTSTRAP_SIZE] __attribute__((aligned(16)));
+	std::atomic<size_t> bootstrapUsed(0);
+
+	// initial-exec TLS is reached without calls, which might allocate
+	__thread ThreadBuffer* threadBuffer __attribute__((tls_model("initial-exec"))) = nullptr;
+	__thread bool isInsideShim __attribute__((tls_model("initial-exec"))) = false;
+	/// Set in the thread which runs dlsym(), other threads wait for it on the mutex.
+	__thread bool isInitializing __attribute__((tls_model("initial-exec"))) = false;
+
+	void* bootstrapAllocate(size_t size)
+	{
+		if (size > BOOTSTRAP_SIZE)
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		size = (size + 15) & ~size_t(15);
+		size_t offset = bootstrapUsed.fetch_add(size);
+		if (offset + size > BOOTSTRAP_SIZE)
+		{
+			errno = ENOMEM;
+			return nullptr;
+		}
+		return bootstrapArena + offset;
+	}
+
+	bool isBootstrap(const void* pointer)
+	{
+		return pointer >= bootstrapArena && pointer < bootstrapArena + BOOTSTRAP_SIZE;
+	}
+
+	void writeAll(const void* data, size_t size)
+	{
+		const char* begin = static_cast<const char*>(data);
+		int file = traceFile.load(std::memory_order_relaxed);
+		while (size != 0 && file >= 0)
+		{
+			ssize_t written = write(file, begin, size);
+			if (written < 0 && errno == EINTR) continue;
+			if (written <= 0) break;
+			begin += written;
+			size -= size_t(written);
+		}
+	}
+
+	void flush(ThreadBuffer* buffer)
+	{
+		writeAll(buffer->records, buffer->count * sizeof(MallocTraceRecord));
+		buffer->count = 0;
+	}
+
+	void lockBuffer(ThreadBuffer* buffer)
+	{
+		// contended only by the destructor of the library
+		while (buffer->isLocked.exchange(true, std::memory_order_acquire))
+		{
+			sched_yield();
+		}
+	}
+
+	void unlockBuffer(ThreadBuffer* buffer)
+	{
+		buffer->isLocked.store(false, std::memory_order_release);
+	}
+
+	void releaseBuffer(void* data)
+	{
+		// the thread exits, its records are written and the buffer is unlinked
+		ThreadBuffer* buffer = static_cast<ThreadBuffer*>(data);
+		pthread_mutex_lock(&stateMutex);
+		flush(buffer);
+		if (buffer->previous != nullptr) buffer->previous->next = buffer->next;
+		else buffers = buffer->next;
+		if (buffer->next != nullptr) buffer->next->previous = buffer->previous;
+		pthread_mutex_unlock(&stateMutex);
+		threadBuffer = nullptr;
+		munmap(buffer, sizeof(ThreadBuffer));
+	}
+
+	void stopInChild()
+	{
+		// the descriptor is shared with the parent, closing it there is up to the parent
+		traceFile.store(-1, std::memory_order_relaxed);
+		if (threadBuffer != nullptr) threadBuffer->count = 0;
+	}
+
+	/// Copies the path with every %p replaced by the process id.
+	void expandPath(const char* path, char* result, const size_t size)
+	{
+		char pid[16];
+		int pidLength = snprintf(pid, sizeof(pid), "%d", int(getpid()));
+		size_t length = 0;
+		for (; *path != '\0' && length + 1 < size; ++path)
+		{
+			if (path[0] == '%' && path[1] == 'p')
+			{
+				for (int index = 0; index < pidLength && length + 1 < size; ++index)
+				{
+					result[length++] = pid[index];
+				}
+				++path;
+			}
+			else
+			{
+				result[length++] = *path;
+			}
+		}
+		result[length] = '\0';
+	}
+
+	void initialize()
+	{
+		pthread_mutex_lock(&stateMutex);
+		if (isInitialized.load(std::memory_order_acquire))
+		{
+			pthread_mutex_unlock(&stateMutex);
+			return;
+		}
+
+		isInitializing = true;
+		realFree = reinterpret_cast<FreeFunction>(dlsym(RTLD_NEXT, "free"));
+		realCalloc = reinterpret_cast<CallocFunction>(dlsym(RTLD_NEXT, "calloc"));
+		realRealloc = reinterpret_cast<ReallocFunction>(dlsym(RTLD_NEXT, "realloc"));
+		realMemalign = reinterpret_cast<MemalignFunction>(dlsym(RTLD_NEXT, "memalign"));
+		realAlignedAlloc = reinterpret_cast<MemalignFunction>(dlsym(RTLD_NEXT, "aligned_alloc"));
+		realPosixMemalign = reinterpret_cast<PosixMemalignFunction>(dlsym(RTLD_NEXT, "posix_memalign"));
+		MallocFunction mallocFunction = reinterpret_cast<MallocFunction>(dlsym(RTLD_NEXT, "malloc"));
+		isInitializing = false;
+
+		// programs started by exec() load the library again, %p keeps them from truncating the capture
+		const char* pathPattern = getenv("CP_SSW_MALLOC_TRACE");
+		char path[512];
+		expandPath(pathPattern == nullptr || *pathPattern == '\0' ? "malloc-%p.trace" : pathPattern, path, sizeof(path));
+		int file = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+		traceFile.store(file, std::memory_order_relaxed);
+		if (file >= 0)
+		{
+			writeAll(MALLOC_TRACE_MAGIC, sizeof(MALLOC_TRACE_MAGIC));
+			pthread_key_create(&bufferKey, releaseBuffer);
+			pthread_atfork(nullptr, nullptr, stopInChild);
+		}
+		realMalloc = mallocFunction;
+		isInitialized.store(realMalloc != nullptr, std::memory_order_release);
+		pthread_mutex_unlock(&stateMutex);
+	}
+
+	/// False while dlsym() runs, requests are served from the bootstrap arena then.
+	bool isReady()
+	{
+		if (!isInitialized.load(std::memory_order_acquire) && !isInitializing)
+		{
+			initialize();
+		}
+		return isInitialized.load(std::memory_order_acquire);
+	}
+
+	ThreadBuffer* createBuffer()
+	{
+		void* region = mmap(nullptr, sizeof(ThreadBuffer), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (region == MAP_FAILED)
+		{
+			return nullptr;
+		}
+		ThreadBuffer* buffer = new (region) ThreadBuffer;
+		buffer->isLocked.store(false, std::memory_order_relaxed);
+		buffer->isClosed = false;
+		buffer->count = 0;
+		buffer->thread = threadsCount++;
+		buffer->previous = nullptr;
+
+		pthread_mutex_lock(&stateMutex);
+		buffer->next = buffers;
+		if (buffers != nullptr) buffers->previous = buffer;
+		buffers = buffer;
+		pthread_mutex_unlock(&stateMutex);
+		// the key table may allocate, such calls are made inside the shim and are not recorded
+		pthread_setspecific(bufferKey, buffer);
+		threadBuffer = buffer;
+		return buffer;
+	}
+
+	void record(const MallocTraceOp op, const void* address, const uint64_t size, const uint64_t recordSequence)
+	{
+		if (traceFile.load(std::memory_order_relaxed) < 0 || isInsideShim)
+		{
+			return;
+		}
+		isInsideShim = true;
+		ThreadBuffer* buffer = (threadBuffer != nullptr ? threadBuffer : createBuffer());
+		if (buffer != nullptr)
+		{
+			lockBuffer(buffer);
+		}
+		if (buffer != nullptr && !buffer->isClosed)
+		{
+			MallocTraceRecord& traceRecord = buffer->records[buffer->count++];
+			traceRecord.sequence = recordSequence;
+			traceRecord.address = reinterpret_cast<uintptr_t>(address);
+			traceRecord.size = size;
+			traceRecord.thread = buffer->thread;
+			traceRecord.op = op;
+			memset(traceRecord.reserved, 0, sizeof(traceRecord.reserved));
+			if (buffer->count == BUFFER_RECORDS)
+			{
+				flush(buffer);
+			}
+		}
+		if (buffer != nullptr)
+		{
+			unlockBuffer(buffer);
+		}
+		isInsideShim = false;
+	}
+
+	// an allocation is numbered after it is granted, a free before the memory goes back
+	void recordAllocate(const void* address, const uint64_t size)
+	{
+		if (address != nullptr) record(MallocTraceAllocate, address, size, sequence.fetch_add(1, std::memory_order_relaxed));
+	}
+
+	void recordFree(const void* address)
+	{
+		record(MallocTraceFree, address, 0, sequence.fetch_add(1, std::memory_order_relaxed));
+	}
+
+	__attribute__((constructor)) void startTrace()
+	{
+		isReady();
+	}
+
+	__attribute__((destructor)) void finishTrace()
+	{
+		// a child of fork() writes nothing, its copies of the locks may be held by threads of the parent
+		if (traceFile.load(std::memory_order_relaxed) < 0)
+		{
+			return;
+		}
+		// threads still running lose what they record from now on
+		pthread_mutex_lock(&stateMutex);
+		for (ThreadBuffer* buffer = buffers; buffer != nullptr; buffer = buffer->next)
+		{
+			lockBuffer(buffer);
+			flush(buffer);
+			buffer->isClosed = true;
+			unlockBuffer(buffer);
+		}
+		int file = traceFile.exchange(-1);
+		if (file >= 0)
+		{
+			close(file);
+		}
+		pthread_mutex_unlock(&stateMutex);
+	}
+}
+
+extern "C"
+{
+	void* malloc(size_t size)
+	{
+		if (!isReady()) return bootstrapAllocate(size);
+		void* result = realMalloc(size);
+		recordAllocate(result, size);
+		return result;
+	}
+
+	void free(void* pointer)
+	{
+		if (pointer == nullptr || isBootstrap(pointer)) return;
+		if (!isReady()) return;
+		recordFree(pointer);
+		realFree(pointer);
+	}
+
+	void* calloc(size_t count, size_t size)
+	{
+		// the arena is static, so it is zeroed already
+		if (!isReady())
+		{
+			if (size != 0 && count > SIZE_MAX / size)
+			{
+				errno = ENOMEM;
+				return nullptr;
+			}
+			return bootstrapAllocate(count * size);
+		}
+		void* result = realCalloc(count, size);
+		recordAllocate(result, uint64_t(count) * size);
+		return result;
+	}
+
+	void* realloc(void* pointer, size_t size)
+	{
+		if (pointer == nullptr)
+		{
+			return malloc(size);
+		}
+		// while dlsym() runs the new block comes from the arena too, after the old one, so the copy may overlap
+		if (isBootstrap(pointer))
+		{
+			void* result = malloc(size);
+			if (result != nullptr)
+			{
+				size_t available = bootstrapArena + BOOTSTRAP_SIZE - static_cast<char*>(pointer);
+				memmove(result, pointer, size < available ? size : available);
+			}
+			return result;
+		}
+		if (!isReady()) return nullptr;
+
+		// the number of the free is taken before the old block may be reused
+		uint64_t freeSequence = sequence.fetch_add(1, std::memory_order_relaxed);
+		void* result = realRealloc(pointer, size);
+		if (result != nullptr || size == 0)
+		{
+			record(MallocTraceFree, pointer, 0, freeSequence);
+			recordAllocate(result, size);
+		}
+		return result;
+	}
+
+	void* memalign(size_t alignment, size_t size)
+	{
+		if (!isReady()) return nullptr;
+		void* result = realMemalign(alignment, size);
+		recordAllocate(result, size);
+		return result;
+	}
+
+	void* aligned_alloc(size_t alignment, size_t size)
+	{
+		if (!isReady()) return nullptr;
+		void* result = realAlignedAlloc(alignment, size);
+		recordAllocate(result, size);
+		return result;
+	}
+
+	int posix_memalign(void** pointer, size_t alignment, size_t size)
+	{
+		if (!isReady()) return ENOMEM;
+		int result = realPosixMemalign(pointer, alignment, size);
+		if (result == 0) recordAllocate(*pointer, size);
+		return result;
+	}
+}
@@ -0,0 +1,30 @@
+#ifndef MALLOC_TRACE_H
+#define MALLOC_TRACE_H
+
+#include <stdint.h>
+
+/// Binary capture written by the preload library, read by the capture tool.
+/// The file is a header followed by records of all threads, each thread appends its records in chunks.
+/// Records are ordered by their sequence numbers, a free takes its number before the memory is released
+/// and an allocation after it is granted, so a reused address is always freed first.
+
+static const char MALLOC_TRACE_MAGIC[8] = { 'C', 'P', 'S', 'S', 'W', 'M', 'T', '1' };
+
+enum MallocTraceOp : uint8_t
+{
+	MallocTraceAllocate,
+	MallocTraceFree
+};
+
+struct MallocTraceRecord
+{
+	uint64_t sequence;
+	uint64_t address;
+	/// Requested bytes of an allocation, zero for a free.
+	uint64_t size;
+	uint32_t thread;
+	uint8_t op;
+	uint8_t reserved[3];
+};
+
+#endif // MALLOC_TRACE_H
@@ -0,0 +1,17 @@
+#-------------------------------------------------
+#
+# Capture of allocator calls of real programs, loaded with
+# LD_PRELOAD=libCP_SSW_preload.so, see ../capture for the conversion
+#
+#-------------------------------------------------
+
+CONFIG -= qt
+
+TARGET = CP_SSW_preload
+TEMPLATE = lib
+CONFIG += plugin
+
+LIBS += -ldl -lpthread
+
+HEADERS += malloc_trace.h
+SOURCES += malloc_shim.cpp
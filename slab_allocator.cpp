@@ -0,0 +1,493 @@
+#include "slab_allocator.h"
+#include "state_buffer.h"
+
+const uint32_t SlabAllocator::SLAB_MIN_OBJECTS;
+
+SlabAllocator::SlabAllocator(Memory* mem, NameTable* names) :
+	lastFailure(FailureReason::None),
+	isUndoEnabled(false)
+{
+	this->mem = mem;
+	this->names = names;
+}
+
+SlabAllocator::~SlabAllocator()
+{
+	clear();
+}
+
+QResultStatus SlabAllocator::allocate(const QString& objectName, const uint64_t objectSize, const uint32_t objectId)
+{
+	QString cacheName = getCacheName(objectName);
+	if (cacheName.isEmpty() || objectSize == 0 || objectId == NameTable::NO_NAME)
+	{
+		lastFailure = FailureReason::InvalidName;
+		return QResult_IncorrectData;
+	}
+	if (objects.contains(objectId))
+	{
+		lastFailure = FailureReason::DuplicateName;
+		return QResult_ActionUnavailable;
+	}
+
+	SlabCache* cache = caches.value(cacheName, nullptr);
+	if (cache == nullptr)
+	{
+		cache = createCache(cacheName, objectSize);
+		if (cache == nullptr)
+		{
+			lastFailure = FailureReason::TooLarge;
+			return QResult_DataOutOfRange;
+		}
+		logUndo(SlabUndoOp::CreateCache, cache, 0);
+	}
+	else if (cache->objectSize != objectSize)
+	{
+		// all objects of a cache have the same size
+		lastFailure = FailureReason::SizeMismatch;
+		return QResult_IncorrectData;
+	}
+
+	if (cache->partialSlabs.isEmpty())
+	{
+		uint32_t pageId = names->intern(getPageName(cache->name, cache->slabsCreated));
+		QResultStatus resultStatus = mem->allocate(MemorySettings::degreeToBytes(cache->slabDegree), pageId);
+		if (resultStatus != QResult_Success)
+		{
+			lastFailure = mem->getLastFailure();
+			return resultStatus;
+		}
+		createSlab(cache, pageId);
+		++cache->slabsCreated;
+		logUndo(SlabUndoOp::CreateSlab, cache, pageId);
+	}
+
+	Slab* slab = cache->partialSlabs.first();
+	uint32_t index = slab->freeObjects.findFirst();
+	slab->freeObjects.reset(index);
+	slab->objectIds[index] = objectId;
+	if (slab->freeObjects.getCount() == 0)
+	{
+		cache->partialSlabs.remove(slab->pageId);
+	}
+	ObjectPlace place = { cache, slab, index };
+	objects.insert(objectId, place);
+	logUndo(SlabUndoOp::TakeObject, cache, slab->pageId, index, objectId);
+	lastFailure = FailureReason::None;
+	return QResult_Success;
+}
+
+QResultStatus SlabAllocator::free(const uint32_t objectId)
+{
+	if (!objects.contains(objectId))
+	{
+		lastFailure = FailureReason::NotAllocated;
+		return QResult_Failure;
+	}
+
+	ObjectPlace place = objects.take(objectId);
+	SlabCache* cache = place.cache;
+	Slab* slab = place.slab;
+	slab->freeObjects.set(place.index);
+	slab->objectIds[place.index] = NameTable::NO_NAME;
+	cache->partialSlabs.insert(slab->pageId, slab);
+	logUndo(SlabUndoOp::ReturnObject, cache, slab->pageId, place.index, objectId);
+
+	QResultStatus resultStatus = QResult_Success;
+	// the only slab is kept, so a cache which empties and fills again does not split and merge a page each time
+	if (slab->freeObjects.getCount() == cache->objectsPerSlab && cache->slabs.size() > 1)
+	{
+		uint32_t pageId = slab->pageId;
+		resultStatus = mem->free(pageId);
+		deleteSlab(cache, pageId);
+		logUndo(SlabUndoOp::ReleaseSlab, cache, pageId);
+	}
+	lastFailure = (resultStatus == QResult_Success ? FailureReason::None : mem->getLastFailure());
+	return resultStatus;
+}
+
+QString SlabAllocator::query(const uint32_t objectId) const
+{
+	if (!objects.contains(objectId))
+	{
+		return QString("Object %1 not found.").arg(names->getName(objectId));
+	}
+
+	ObjectPlace place = objects.value(objectId);
+	uint64_t beginAddress = mem->getBeginAddress(place.slab->pageId) + place.index * place.cache->objectSize;
+	return QString("Object %1 > Size = %2 -> [%3; %4] in slab %5").arg(
+				names->getName(objectId),
+				MemorySettings::bytesToString(place.cache->objectSize),
+				MemorySettings::bytesToString(beginAddress),
+				MemorySettings::bytesToString(beginAddress + place.cache->objectSize),
+				names->getName(place.slab->pageId));
+}
+
+bool SlabAllocator::isPage(const uint32_t procId) const
+{
+	return pageIds.contains(procId);
+}
+
+void SlabAllocator::clear()
+{
+	// pages of the slabs are left to the owner of memory
+	for (QMap<QString, SlabCache*>::const_iterator cache = caches.constBegin(); cache != caches.constEnd(); ++cache)
+	{
+		for (QMap<uint32_t, Slab*>::const_iterator slab = cache.value()->slabs.constBegin();
+			 slab != cache.value()->slabs.constEnd(); ++slab)
+		{
+			delete slab.value();
+		}
+		delete cache.value();
+	}
+	caches.clear();
+	objects.clear();
+	pageIds.clear();
+	undoLog.clear();
+}
+
+FailureReason SlabAllocator::getLastFailure() const
+{
+	return lastFailure;
+}
+
+SlabStats SlabAllocator::getStats() const
+{
+	SlabStats stats = SlabStats();
+	stats.cachesCount = caches.size();
+	for (QMap<QString, SlabCache*>::const_iterator cache = caches.constBegin(); cache != caches.constEnd(); ++cache)
+	{
+		uint64_t objectsCount = 0;
+		for (QMap<uint32_t, Slab*>::const_iterator slab = cache.value()->slabs.constBegin();
+			 slab != cache.value()->slabs.constEnd(); ++slab)
+		{
+			objectsCount += cache.value()->objectsPerSlab - slab.value()->freeObjects.getCount();
+		}
+		stats.slabsCount += cache.value()->slabs.size();
+		stats.objectsCount += objectsCount;
+		stats.objectBytes += objectsCount * cache.value()->objectSize;
+		stats.slabBytes += cache.value()->slabs.size() * MemorySettings::degreeToBytes(cache.value()->slabDegree);
+	}
+	return stats;
+}
+
+QResultStatus SlabAllocator::checkInvariants(QString* violation) const
+{
+	QString problem;
+	try {
+		uint32_t placedObjects = 0;
+		uint32_t slabsCount = 0;
+		for (QMap<QString, SlabCache*>::const_iterator cache = caches.constBegin(); cache != caches.constEnd(); ++cache)
+		{
+			for (QMap<uint32_t, Slab*>::const_iterator slab = cache.value()->slabs.constBegin();
+				 slab != cache.value()->slabs.constEnd(); ++slab)
+			{
+				const Slab* current = slab.value();
+				if (current->pageId != slab.key() || mem->getBeginAddress(current->pageId) == UINT64_MAX) {
+					problem = QString("slab %1 has no page in memory").arg(names->getName(slab.key()));
+					throw QResult_IncorrectData;
+				}
+				if (!pageIds.contains(slab.key())) {
+					problem = QString("page of slab %1 is not indexed").arg(names->getName(slab.key()));
+					throw QResult_IncorrectData;
+				}
+				++slabsCount;
+				if ((uint32_t)current->objectIds.size() != cache.value()->objectsPerSlab) {
+					problem = QString("slab %1 has a wrong quantity of places").arg(names->getName(slab.key()));
+					throw QResult_IncorrectData;
+				}
+
+				uint32_t freePlaces = 0;
+				for (uint32_t index = 0; index < cache.value()->objectsPerSlab; ++index)
+				{
+					uint32_t objectId = current->objectIds.at(index);
+					if ((objectId == NameTable::NO_NAME) != current->freeObjects.test(index)) {
+						problem = QString("place %1 of slab %2 differs from its free bit").arg(index).arg(names->getName(slab.key()));
+						throw QResult_IncorrectData;
+					}
+					if (objectId == NameTable::NO_NAME)
+					{
+						++freePlaces;
+						continue;
+					}
+					ObjectPlace place = objects.value(objectId, ObjectPlace());
+					if (!objects.contains(objectId) || place.cache != cache.value() || place.slab != current || place.index != index) {
+						problem = QString("object %1 is not indexed to its place").arg(names->getName(objectId));
+						throw QResult_IncorrectData;
+					}
+					++placedObjects;
+				}
+				if (freePlaces != current->freeObjects.getCount() ||
+						(freePlaces != 0) != cache.value()->partialSlabs.contains(slab.key())) {
+					problem = QString("slab %1 is listed as partial by mistake").arg(names->getName(slab.key()));
+					throw QResult_IncorrectData;
+				}
+			}
+			if (cache.value()->partialSlabs.size() > cache.value()->slabs.size()) {
+				problem = QString("cache %1 lists partial slabs which it does not own").arg(cache.key());
+				throw QResult_IncorrectData;
+			}
+		}
+		if (placedObjects != (uint32_t)objects.size()) {
+			problem = "objects are indexed to places which they do not occupy";
+			throw QResult_IncorrectData;
+		}
+		if (slabsCount != (uint32_t)pageIds.size()) {
+			problem = "pages are indexed for slabs which do not exist";
+			throw QResult_IncorrectData;
+		}
+	} catch (QResultStatus resultStatus) {
+		if (violation != nullptr)
+		{
+			*violation = problem;
+		}
+		return resultStatus;
+	}
+	return QResult_Success;
+}
+
+QResultStatus SlabAllocator::saveState(QByteArray* state) const
+{
+	if (state == nullptr)
+	{
+		return QResult_NullPointer;
+	}
+
+	// caches by name, slabs by page id and objects by their place
+	state->clear();
+	appendValue(state, uint32_t(caches.size()));
+	for (QMap<QString, SlabCache*>::const_iterator cache = caches.constBegin(); cache != caches.constEnd(); ++cache)
+	{
+		QByteArray name = cache.key().toUtf8();
+		appendValue(state, uint32_t(name.size()));
+		state->append(name);
+		appendValue(state, cache.value()->objectSize);
+		appendValue(state, cache.value()->slabsCreated);
+		appendValue(state, uint32_t(cache.value()->slabs.size()));
+		for (QMap<uint32_t, Slab*>::const_iterator slab = cache.value()->slabs.constBegin();
+			 slab != cache.value()->slabs.constEnd(); ++slab)
+		{
+			appendValue(state, slab.key());
+			foreach (uint32_t objectId, slab.value()->objectIds)
+			{
+				appendValue(state, objectId);
+			}
+		}
+	}
+	return QResult_Success;
+}
+
+QResultStatus SlabAllocator::loadState(const QByteArray& state)
+{
+	clear();
+	try {
+		int offset = 0;
+		uint32_t cachesCount = 0;
+		if (!readValue(state, &offset, &cachesCount)) {
+			throw QResult_IncorrectData;
+		}
+		for (uint32_t cacheIndex = 0; cacheIndex < cachesCount; ++cacheIndex)
+		{
+			uint32_t nameSize = 0;
+			if (!readValue(state, &offset, &nameSize) || offset + (int64_t)nameSize > state.size()) {
+				throw QResult_IncorrectData;
+			}
+			QString name = QString::fromUtf8(state.constData() + offset, nameSize);
+			offset += nameSize;
+
+			uint64_t objectSize = 0;
+			uint32_t slabsCreated = 0;
+			uint32_t slabsCount = 0;
+			if (!readValue(state, &offset, &objectSize) || !readValue(state, &offset, &slabsCreated) ||
+					!readValue(state, &offset, &slabsCount) || name.isEmpty() || caches.contains(name) || objectSize == 0) {
+				throw QResult_IncorrectData;
+			}
+			SlabCache* cache = createCache(name, objectSize);
+			if (cache == nullptr) {
+				throw QResult_IncorrectData;
+			}
+			cache->slabsCreated = slabsCreated;
+
+			for (uint32_t slabIndex = 0; slabIndex < slabsCount; ++slabIndex)
+			{
+				uint32_t pageId = NameTable::NO_NAME;
+				// the page itself is restored with memory
+				if (!readValue(state, &offset, &pageId) || cache->slabs.contains(pageId) ||
+						mem->getBeginAddress(pageId) == UINT64_MAX) {
+					throw QResult_IncorrectData;
+				}
+				Slab* slab = createSlab(cache, pageId);
+				for (uint32_t index = 0; index < cache->objectsPerSlab; ++index)
+				{
+					uint32_t objectId = NameTable::NO_NAME;
+					if (!readValue(state, &offset, &objectId) || objects.contains(objectId)) {
+						throw QResult_IncorrectData;
+					}
+					if (objectId != NameTable::NO_NAME)
+					{
+						slab->freeObjects.reset(index);
+						slab->objectIds[index] = objectId;
+						ObjectPlace place = { cache, slab, index };
+						objects.insert(objectId, place);
+					}
+				}
+				if (slab->freeObjects.getCount() == 0)
+				{
+					cache->partialSlabs.remove(pageId);
+				}
+			}
+		}
+		if (offset != state.size()) {
+			throw QResult_IncorrectData;
+		}
+		return QResult_Success;
+	}
+	catch (QResultStatus resultStatus)
+	{
+		clear();
+		return resultStatus;
+	}
+}
+
+void SlabAllocator::setUndoEnabled(bool value)
+{
+	isUndoEnabled = value;
+	undoLog.clear();
+}
+
+void SlabAllocator::clearUndoLog()
+{
+	undoLog.clear();
+}
+
+uint32_t SlabAllocator::getUndoOpsCount() const
+{
+	return undoLog.size();
+}
+
+QResultStatus SlabAllocator::undoTo(const uint32_t opsCount)
+{
+	if (opsCount > (uint32_t)undoLog.size())
+	{
+		return QResult_IndexOutOfRange;
+	}
+	while ((uint32_t)undoLog.size() > opsCount)
+	{
+		undo(undoLog.takeLast());
+	}
+	return QResult_Success;
+}
+
+QString SlabAllocator::getCacheName(const QString& objectName)
+{
+	int separator = objectName.indexOf(':');
+	return separator > 0 ? objectName.left(separator) : QString();
+}
+
+QString SlabAllocator::getPageName(const QString& cacheName, const uint32_t slabNumber)
+{
+	// command names never hold spaces, so no command can take or free a page
+	return QString("%1 #%2").arg(cacheName).arg(slabNumber);
+}
+
+SlabCache* SlabAllocator::createCache(const QString& name, const uint64_t objectSize)
+{
+	// the smallest block which holds enough objects
+	uint8_t slabDegree = mem->getMinDegree();
+	while (slabDegree < mem->getTotalDegree() &&
+		   MemorySettings::degreeToBytes(slabDegree) / objectSize < SLAB_MIN_OBJECTS)
+	{
+		++slabDegree;
+	}
+	if (MemorySettings::degreeToBytes(slabDegree) < objectSize)
+	{
+		return nullptr;
+	}
+
+	SlabCache* cache = new SlabCache();
+	cache->name = name;
+	cache->objectSize = objectSize;
+	cache->slabDegree = slabDegree;
+	cache->objectsPerSlab = MemorySettings::degreeToBytes(slabDegree) / objectSize;
+	cache->slabsCreated = 0;
+	caches.insert(name, cache);
+	return cache;
+}
+
+Slab* SlabAllocator::createSlab(SlabCache* cache, const uint32_t pageId)
+{
+	Slab* slab = new Slab();
+	slab->pageId = pageId;
+	slab->objectIds.fill(NameTable::NO_NAME, cache->objectsPerSlab);
+	for (uint32_t index = 0; index < cache->objectsPerSlab; ++index)
+	{
+		slab->freeObjects.set(index);
+	}
+	cache->slabs.insert(pageId, slab);
+	cache->partialSlabs.insert(pageId, slab);
+	pageIds.insert(pageId);
+	return slab;
+}
+
+void SlabAllocator::deleteSlab(SlabCache* cache, const uint32_t pageId)
+{
+	cache->partialSlabs.remove(pageId);
+	pageIds.remove(pageId);
+	delete cache->slabs.take(pageId);
+}
+
+void SlabAllocator::logUndo(const SlabUndoOp::Type type, SlabCache* cache, const uint32_t pageId,
+							const uint32_t index, const uint32_t objectId)
+{
+	if (!isUndoEnabled) return;
+
+	SlabUndoOp op;
+	op.type = type;
+	op.cache = cache;
+	op.pageId = pageId;
+	op.index = index;
+	op.objectId = objectId;
+	undoLog.push_back(op);
+}
+
+void SlabAllocator::undo(const SlabUndoOp& op)
+{
+	switch (op.type)
+	{
+		case SlabUndoOp::CreateCache:
+			// slabs of the cache were reverted before
+			caches.remove(op.cache->name);
+			delete op.cache;
+			break;
+		case SlabUndoOp::CreateSlab:
+			deleteSlab(op.cache, op.pageId);
+			--op.cache->slabsCreated;
+			break;
+		case SlabUndoOp::ReleaseSlab:
+			// objects come back with the following ops
+			createSlab(op.cache, op.pageId);
+			break;
+		case SlabUndoOp::TakeObject:
+		{
+			Slab* slab = op.cache->slabs.value(op.pageId);
+			slab->freeObjects.set(op.index);
+			slab->objectIds[op.index] = NameTable::NO_NAME;
+			op.cache->partialSlabs.insert(op.pageId, slab);
+			objects.remove(op.objectId);
+			break;
+		}
+		case SlabUndoOp::ReturnObject:
+		{
+			Slab* slab = op.cache->slabs.value(op.pageId);
+			slab->freeObjects.reset(op.index);
+			slab->objectIds[op.index] = op.objectId;
+			if (slab->freeObjects.getCount() == 0)
+			{
+				op.cache->partialSlabs.remove(op.pageId);
+			}
+			ObjectPlace place = { op.cache, slab, op.index };
+			objects.insert(op.objectId, place);
+			break;
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#ifndef SLAB_ALLOCATOR_H
+#define SLAB_ALLOCATOR_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QSet>
+#include <QMap>
+#include <QByteArray>
+
+#include "common.h"
+#include "memory.h"
+#include "name_table.h"
+#include "free_bitmap.h"
+
+/// Page of a cache carved into objects of the same size.
+struct Slab
+{
+	/// Process id of the buddy block which holds the slab.
+	uint32_t pageId;
+	/// Objects by their place in the slab, NO_NAME for free places.
+	QVector<uint32_t> objectIds;
+	FreeBitmap freeObjects;
+};
+
+/// Objects of one size, served from slabs.
+struct SlabCache
+{
+	QString name;
+	uint64_t objectSize;
+	uint8_t slabDegree;
+	uint32_t objectsPerSlab;
+	/// Slabs ever created, numbers the names of their pages.
+	uint32_t slabsCreated;
+	/// Slabs by the id of their page.
+	QMap<uint32_t, Slab*> slabs;
+	/// Slabs with free places, the one with the lowest page id is filled first.
+	QMap<uint32_t, Slab*> partialSlabs;
+};
+
+/// Change of slab caches which can be reverted.
+struct SlabUndoOp
+{
+	enum Type : uint8_t
+	{
+		CreateCache,
+		CreateSlab,
+		ReleaseSlab,
+		TakeObject,
+		ReturnObject
+	};
+
+	Type type;
+	SlabCache* cache;
+	uint32_t pageId;
+	uint32_t index;
+	uint32_t objectId;
+};
+
+/// Totals over all slab caches.
+struct SlabStats
+{
+	uint32_t cachesCount;
+	uint32_t slabsCount;
+	uint64_t objectsCount;
+	uint64_t objectBytes;
+	uint64_t slabBytes;
+};
+
+/// Second level allocator which takes pages from Memory and serves small objects from them.
+/// Objects are named "cache:object", a cache is created by the first allocation from it.
+/// Pages are named "cache #number", which a command cannot name.
+/// A slab is returned to Memory when its last object is freed, unless it is the only slab of the cache.
+class SlabAllocator
+{
+	public:
+		/// Slabs are made large enough for this quantity of objects when memory allows it.
+		static const uint32_t SLAB_MIN_OBJECTS = 8;
+
+		SlabAllocator(Memory* mem, NameTable* names);
+		~SlabAllocator();
+
+		QResultStatus allocate(const QString& objectName, const uint64_t objectSize, const uint32_t objectId);
+		QResultStatus free(const uint32_t objectId);
+		QString query(const uint32_t objectId) const;
+		/// Tells whether the process id names a page of some slab, such pages are freed only by the allocator.
+		bool isPage(const uint32_t procId) const;
+		void clear();
+		SlabStats getStats() const;
+		FailureReason getLastFailure() const;
+		/// Verifies slabs against their objects and pages, the first violation is described.
+		QResultStatus checkInvariants(QString* violation = nullptr) const;
+		QResultStatus saveState(QByteArray* state) const;
+		QResultStatus loadState(const QByteArray& state);
+		void setUndoEnabled(bool value);
+		void clearUndoLog();
+		uint32_t getUndoOpsCount() const;
+		QResultStatus undoTo(const uint32_t opsCount);
+
+		static QString getCacheName(const QString& objectName);
+		/// Name of the page of a slab, one which no command can have.
+		static QString getPageName(const QString& cacheName, const uint32_t slabNumber);
+
+	private:
+		/// Place of an allocated object.
+		struct ObjectPlace
+		{
+			SlabCache* cache;
+			Slab* slab;
+			uint32_t index;
+		};
+
+		Memory* mem;
+		NameTable* names;
+		QMap<QString, SlabCache*> caches;
+		QHash<uint32_t, ObjectPlace> objects;
+		FailureReason lastFailure;
+		/// Page ids of the slabs of all caches, so plain frees do not look through every cache.
+		QSet<uint32_t> pageIds;
+		bool isUndoEnabled;
+		/// Changes made since the log was enabled or cleared, the newest is the last.
+		QVector<SlabUndoOp> undoLog;
+
+		SlabCache* createCache(const QString& name, const uint64_t objectSize);
+		Slab* createSlab(SlabCache* cache, const uint32_t pageId);
+		void deleteSlab(SlabCache* cache, const uint32_t pageId);
+		void logUndo(const SlabUndoOp::Type type, SlabCache* cache, const uint32_t pageId,
+					 const uint32_t index = 0, const uint32_t objectId = NameTable::NO_NAME);
+		void undo(const SlabUndoOp& op);
+};
+
+#endif // SLAB_ALLOCATOR_H
@@ -0,0 +1,27 @@
+#ifndef STATE_BUFFER_H
+#define STATE_BUFFER_H
+
+#include <QtCore/qglobal.h>
+#include <QByteArray>
+#include <cstring>
+
+/// Plain values of saved states, written in the byte order of the machine.
+template <typename T>
+inline void appendValue(QByteArray* state, const T value)
+{
+	state->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+inline bool readValue(const QByteArray& state, int* offset, T* value)
+{
+	if (*offset + (int)sizeof(T) > state.size())
+	{
+		return false;
+	}
+	memcpy(value, state.constData() + *offset, sizeof(T));
+	*offset += sizeof(T);
+	return true;
+}
+
+#endif // STATE_BUFFER_H
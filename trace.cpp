@@ -0,0 +1,92 @@
+#include "trace.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <chrono>
+
+const uint32_t TraceBuffer::CAPACITY;
+
+QMutex Tracer::buffersMutex;
+QVector<TraceBuffer*> Tracer::buffers;
+
+static thread_local TraceBuffer* threadBuffer = nullptr;
+
+bool Tracer::isEnabled()
+{
+#ifdef MEMORY_TRACING
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Tracer::record(const char* name, const uint64_t begin, const uint64_t end)
+{
+	TraceBuffer* buffer = threadBuffer;
+	if (buffer == nullptr)
+	{
+		buffer = getThreadBuffer();
+	}
+
+	TraceEvent& event = buffer->events[buffer->eventsCount % TraceBuffer::CAPACITY];
+	event.name = name;
+	event.begin = begin;
+	event.duration = end - begin;
+	++buffer->eventsCount;
+}
+
+QResultStatus Tracer::toJson(const QString& pathToFile)
+{
+	QFile file(pathToFile);
+	if (!file.open(QFile::WriteOnly | QFile::Text)) {
+		return QResult_UnexpectedError;
+	}
+
+	QMutexLocker locker(&buffersMutex);
+	QTextStream stream(&file);
+	stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	bool isFirst = true;
+	foreach (const TraceBuffer* buffer, buffers)
+	{
+		uint64_t firstEvent = buffer->eventsCount > TraceBuffer::CAPACITY ? buffer->eventsCount - TraceBuffer::CAPACITY : 0;
+		for (uint64_t eventIndex = firstEvent; eventIndex < buffer->eventsCount; ++eventIndex)
+		{
+			// complete events, times are in microseconds
+			const TraceEvent& event = buffer->events[eventIndex % TraceBuffer::CAPACITY];
+			stream << (isFirst ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+				   << buffer->threadIndex << ",\"ts\":" << QString::number(event.begin / 1e3, 'f', 3)
+				   << ",\"dur\":" << QString::number(event.duration / 1e3, 'f', 3) << "}";
+			isFirst = false;
+		}
+	}
+	stream << "\n]}\n";
+	stream.flush();
+	file.close();
+	return QResult_Success;
+}
+
+void Tracer::clear()
+{
+	QMutexLocker locker(&buffersMutex);
+	foreach (TraceBuffer* buffer, buffers)
+	{
+		buffer->eventsCount = 0;
+	}
+}
+
+TraceBuffer* Tracer::getThreadBuffer()
+{
+	// buffers outlive their threads, so events of finished threads can be exported
+	QMutexLocker locker(&buffersMutex);
+	threadBuffer = new TraceBuffer();
+	threadBuffer->threadIndex = buffers.size();
+	threadBuffer->eventsCount = 0;
+	buffers.push_back(threadBuffer);
+	return threadBuffer;
+}
@@ -0,0 +1,80 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+#include <QVector>
+#include <QMutex>
+
+#include "common.h"
+
+/// Trace points are compiled only with MEMORY_TRACING defined, "qmake CONFIG+=tracing" defines it.
+/// A trace point measures the enclosing scope and costs nothing when tracing is off.
+#ifdef MEMORY_TRACING
+#define MEMORY_TRACE_CONCAT_(first, second) first##second
+#define MEMORY_TRACE_CONCAT(first, second) MEMORY_TRACE_CONCAT_(first, second)
+#define MEMORY_TRACE_SCOPE(name) TraceScope MEMORY_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define MEMORY_TRACE_SCOPE(name) do { } while (0)
+#endif
+
+/// Duration of one traced scope, in nanoseconds of a steady clock.
+struct TraceEvent
+{
+	const char* name;
+	uint64_t begin;
+	uint64_t duration;
+};
+
+/// Ring of the latest events of one thread, only that thread writes it.
+struct TraceBuffer
+{
+	static const uint32_t CAPACITY = 1 << 16;
+
+	uint32_t threadIndex;
+	/// Events ever recorded, the oldest ones are overwritten.
+	uint64_t eventsCount;
+	TraceEvent events[CAPACITY];
+};
+
+/// Collects events of trace points from all threads.
+/// Recording takes no lock, a thread registers its buffer once under a mutex.
+class Tracer
+{
+	public:
+		static bool isEnabled();
+		static uint64_t now();
+		static void record(const char* name, const uint64_t begin, const uint64_t end);
+		/// Writes events in the Chrome trace event format, while no thread is recording.
+		static QResultStatus toJson(const QString& pathToFile);
+		static void clear();
+
+	private:
+		static QMutex buffersMutex;
+		static QVector<TraceBuffer*> buffers;
+
+		static TraceBuffer* getThreadBuffer();
+};
+
+/// Records the time from its construction to the end of the scope.
+class TraceScope
+{
+	public:
+		explicit TraceScope(const char* name) :
+			name(name),
+			begin(Tracer::now())
+		{
+
+		}
+
+		~TraceScope()
+		{
+			Tracer::record(name, begin, Tracer::now());
+		}
+
+	private:
+		const char* name;
+		uint64_t begin;
+};
+
+#endif // TRACE_H
@@ -181,4 +181,7 @@ void WindowMain::showInfo()
 	ui->spaceInUseLabel->setText(MemoryInfo::usedMemory);
 	ui->blockMinSizeLabel->setText(MemoryInfo::smallestBlockSize);
 	ui->blocksQuantityLabel->setText(QString::number(MemoryInfo::blocksQuantity));
+	ui->allocateLatencyLabel->setText(MemoryInfo::allocateLatency);
+	ui->freeLatencyLabel->setText(MemoryInfo::freeLatency);
+	ui->queryLatencyLabel->setText(MemoryInfo::queryLatency);
 }
@@ -0,0 +1,240 @@
+#include "workload_generator.h"
+
+#include <cstring>
+
+QResultStatus WorkloadParams::sizeDistributionFromString(const QString& str, SizeDistribution* value)
+{
+	if (str == "uniform") *value = SizeDistribution::Uniform;
+	else if (str == "lognormal") *value = SizeDistribution::LogNormal;
+	else if (str == "pow2") *value = SizeDistribution::PowerOfTwo;
+	else return QResult_IncorrectData;
+	return QResult_Success;
+}
+
+QResultStatus WorkloadParams::lifetimeDistributionFromString(const QString& str, LifetimeDistribution* value)
+{
+	if (str == "exponential") *value = LifetimeDistribution::Exponential;
+	else if (str == "uniform") *value = LifetimeDistribution::Uniform;
+	else if (str == "fixed") *value = LifetimeDistribution::Fixed;
+	else return QResult_IncorrectData;
+	return QResult_Success;
+}
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadParams& params) :
+	params(params),
+	unit(0.0, 1.0)
+{
+	if (this->params.minSize == 0) this->params.minSize = 1;
+	if (this->params.maxSize < this->params.minSize) this->params.maxSize = this->params.minSize;
+	if (this->params.maxLiveProcesses == 0) this->params.maxLiveProcesses = 1;
+	if (this->params.maxObjectSize < 8) this->params.maxObjectSize = 8;
+	reset();
+}
+
+void WorkloadGenerator::reset()
+{
+	random.seed(params.seed);
+	liveProcesses = decltype(liveProcesses)();
+	cmdIndex = 0;
+	procCounter = 0;
+}
+
+void WorkloadGenerator::next(CommandAction* action, uint64_t* procNumber, uint64_t* size)
+{
+	++cmdIndex;
+	*size = 0;
+
+	// a process is freed on the command its lifetime ends, a little later only when deaths pile up
+	if (!liveProcesses.empty() && std::get<0>(liveProcesses.top()) <= cmdIndex)
+	{
+		// frees of objects carry the object size, which names their cache
+		*procNumber = std::get<1>(liveProcesses.top());
+		*size = std::get<2>(liveProcesses.top());
+		*action = (*size != 0 ? CommandAction::CacheFree : CommandAction::Free);
+		liveProcesses.pop();
+		return;
+	}
+
+	// commands between deaths allocate, the rest query a live process and so space allocations out
+	bool isAllocation = liveProcesses.empty() ||
+			(liveProcesses.size() < params.maxLiveProcesses && unit(random) < params.allocRatio &&
+			 (params.queryRatio <= 0 || unit(random) >= params.queryRatio));
+	if (isAllocation)
+	{
+		bool isObject = params.cacheRatio > 0 && unit(random) < params.cacheRatio;
+		*action = (isObject ? CommandAction::CacheAllocate : CommandAction::Allocate);
+		*procNumber = procCounter++;
+		*size = (isObject ? nextObjectSize() : nextSize());
+		liveProcesses.push(death_t(cmdIndex + nextLifetime(), *procNumber, isObject ? *size : 0));
+	}
+	else
+	{
+		*action = CommandAction::Query;
+		*procNumber = std::get<1>(liveProcesses.top());
+		*size = std::get<2>(liveProcesses.top());
+	}
+}
+
+void WorkloadGenerator::generate(CommandProcessor* processor)
+{
+	CommandAction action;
+	uint64_t procNumber = 0;
+	uint64_t size = 0;
+	QVector<Command*> cmds;
+	cmds.reserve(params.cmdsCount);
+	for (uint64_t index = 0; index < params.cmdsCount; ++index)
+	{
+		next(&action, &procNumber, &size);
+		if (isObjectCmd(action, size))
+		{
+			cmds.push_back(new Command(action, objectName(size, procNumber), size));
+		}
+		else
+		{
+			cmds.push_back(new Command(action, procName(procNumber), size));
+		}
+	}
+	processor->addCmds(cmds);
+}
+
+QResultStatus WorkloadGenerator::toFile(const QString& pathToFile)
+{
+	QFile file(pathToFile);
+	if (!file.open(QFile::WriteOnly)) {
+		return QResult_UnexpectedError;
+	}
+	QResultStatus resultStatus = toFile(&file);
+	file.close();
+	return resultStatus;
+}
+
+QResultStatus WorkloadGenerator::toFile(QFile* file)
+{
+	// formatting by hand into a reused buffer, QString::arg() would dominate the run time
+	const int FLUSH_SIZE = 1 << 20;
+	QByteArray buffer(FLUSH_SIZE + 64, '\0');
+	char* begin = buffer.data();
+	char* end = begin;
+
+	CommandAction action;
+	uint64_t procNumber = 0;
+	uint64_t size = 0;
+	for (uint64_t index = 0; index < params.cmdsCount; ++index)
+	{
+		next(&action, &procNumber, &size);
+		*end++ = Command::actionToChar(action);
+		*end++ = ' ';
+		if (isObjectCmd(action, size))
+		{
+			memcpy(end, "kmalloc-", 8);
+			end = appendNumber(end + 8, size);
+			*end++ = ':';
+		}
+		*end++ = 'P';
+		end = appendNumber(end, procNumber);
+		*end++ = ' ';
+		end = appendNumber(end, size);
+		*end++ = '\n';
+
+		if (end - begin >= FLUSH_SIZE)
+		{
+			if (file->write(begin, end - begin) != end - begin) return QResult_UnexpectedError;
+			end = begin;
+		}
+	}
+	if (file->write(begin, end - begin) != end - begin) return QResult_UnexpectedError;
+	file->flush();
+
+	return QResult_Success;
+}
+
+QString WorkloadGenerator::procName(const uint64_t procNumber)
+{
+	return QString("P%1").arg(procNumber);
+}
+
+QString WorkloadGenerator::objectName(const uint64_t objectSize, const uint64_t procNumber)
+{
+	return QString("kmalloc-%1:P%2").arg(objectSize).arg(procNumber);
+}
+
+uint64_t WorkloadGenerator::nextSize()
+{
+	uint64_t size = params.minSize;
+	switch (params.sizeDistribution)
+	{
+		case SizeDistribution::Uniform:
+			size = params.minSize + random() % (params.maxSize - params.minSize + 1);
+			break;
+		case SizeDistribution::LogNormal:
+		{
+			std::lognormal_distribution<double> distribution(std::log(params.sizeMedian), params.sizeSigma);
+			double value = distribution(random);
+			size = (value >= double(params.maxSize) ? params.maxSize : uint64_t(value));
+			break;
+		}
+		case SizeDistribution::PowerOfTwo:
+		{
+			// log-uniform degree, then either the exact power of two or a size up to the next one
+			uint8_t minDegree = 63 - qCountLeadingZeroBits(quint64(params.minSize));
+			uint8_t maxDegree = 63 - qCountLeadingZeroBits(quint64(params.maxSize));
+			uint8_t degree = minDegree + random() % (maxDegree - minDegree + 1);
+			size = uint64_t(1) << degree;
+			if (unit(random) >= params.powerOfTwoBias)
+			{
+				size += random() % size;
+			}
+			break;
+		}
+	}
+	return qBound(params.minSize, size, params.maxSize);
+}
+
+uint64_t WorkloadGenerator::nextObjectSize()
+{
+	// power-of-two caches from 8 bytes, each equally used
+	uint8_t maxDegree = 63 - qCountLeadingZeroBits(quint64(params.maxObjectSize));
+	return uint64_t(8) << (random() % (maxDegree - 2));
+}
+
+uint64_t WorkloadGenerator::nextLifetime()
+{
+	double lifetime = params.meanLifetime;
+	switch (params.lifetimeDistribution)
+	{
+		case LifetimeDistribution::Exponential:
+			lifetime = -std::log(1.0 - unit(random)) * params.meanLifetime;
+			break;
+		case LifetimeDistribution::Uniform:
+			lifetime = unit(random) * 2 * params.meanLifetime;
+			break;
+		case LifetimeDistribution::Fixed:
+			break;
+	}
+	// rounded, so the mean stays the configured one, yet a process lives for one command at least
+	return qMax<uint64_t>(1, uint64_t(lifetime + 0.5));
+}
+
+bool WorkloadGenerator::isObjectCmd(const CommandAction action, const uint64_t size)
+{
+	// besides allocations only commands of objects carry a size
+	return action != CommandAction::Allocate && size != 0;
+}
+
+char* WorkloadGenerator::appendNumber(char* buffer, uint64_t value)
+{
+	char digits[20];
+	int count = 0;
+	do
+	{
+		digits[count++] = '0' + value % 10;
+		value /= 10;
+	}
+	while (value != 0);
+
+	while (count > 0)
+	{
+		*buffer++ = digits[--count];
+	}
+	return buffer;
+}
@@ -0,0 +1,96 @@
+#ifndef WORKLOAD_GENERATOR_H
+#define WORKLOAD_GENERATOR_H
+
+#include <QtCore/qglobal.h>
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <cmath>
+#include <random>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "common.h"
+#include "command_processor.h"
+
+enum class SizeDistribution
+{
+	Uniform,
+	LogNormal,
+	PowerOfTwo
+};
+
+enum class LifetimeDistribution
+{
+	Exponential,
+	Uniform,
+	Fixed
+};
+
+/// Parameters of a synthetic command trace.
+struct WorkloadParams
+{
+	uint64_t cmdsCount = 1000000;
+	SizeDistribution sizeDistribution = SizeDistribution::LogNormal;
+	uint64_t minSize = 1;
+	uint64_t maxSize = 1 << 20;
+	/// Median and spread of the log-normal distribution, in bytes and in natural log units.
+	double sizeMedian = 1024;
+	double sizeSigma = 1.5;
+	/// Share of exact powers of two for the power-of-two-biased distribution.
+	double powerOfTwoBias = 0.75;
+	LifetimeDistribution lifetimeDistribution = LifetimeDistribution::Exponential;
+	/// Mean lifetime of a process in commands, it is freed by the command its lifetime ends on.
+	double meanLifetime = 1000;
+	/// Share of allocations among commands on which no process dies, the rest are queries.
+	/// Without queries processes are born at the rate allocRatio / (1 + allocRatio), so there are about as many alive
+	/// as that times the mean lifetime.
+	double allocRatio = 1.0;
+	/// Share of queries among commands which would allocate.
+	double queryRatio = 0.0;
+	uint32_t maxLiveProcesses = 1000;
+	/// Share of allocations made as objects of slab caches, named "kmalloc-<size>:P<number>".
+	double cacheRatio = 0.0;
+	/// Largest object size of the power-of-two caches, the smallest one is 8 bytes.
+	uint64_t maxObjectSize = 512;
+	uint64_t seed = 1;
+
+	static QResultStatus sizeDistributionFromString(const QString& str, SizeDistribution* value);
+	static QResultStatus lifetimeDistributionFromString(const QString& str, LifetimeDistribution* value);
+};
+
+/// Generates command traces from parameterized distributions.
+class WorkloadGenerator
+{
+	public:
+		explicit WorkloadGenerator(const WorkloadParams& params);
+
+		void reset();
+		void next(CommandAction* action, uint64_t* procNumber, uint64_t* size);
+		void generate(CommandProcessor* processor);
+		QResultStatus toFile(const QString& pathToFile);
+		QResultStatus toFile(QFile* file);
+
+		static QString procName(const uint64_t procNumber);
+		static QString objectName(const uint64_t objectSize, const uint64_t procNumber);
+
+	private:
+		/// Process waiting for its death, ordered by the death command index, with its object size for cache objects.
+		typedef std::tuple<uint64_t, uint64_t, uint64_t> death_t;
+
+		WorkloadParams params;
+		std::mt19937_64 random;
+		std::uniform_real_distribution<double> unit;
+		std::priority_queue<death_t, std::vector<death_t>, std::greater<death_t>> liveProcesses;
+		uint64_t cmdIndex;
+		uint64_t procCounter;
+
+		uint64_t nextSize();
+		uint64_t nextObjectSize();
+		uint64_t nextLifetime();
+		static char* appendNumber(char* buffer, uint64_t value);
+		static bool isObjectCmd(const CommandAction action, const uint64_t size);
+};
+
+#endif // WORKLOAD_GENERATOR_H
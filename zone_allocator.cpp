@@ -0,0 +1,206 @@
+#include "zone_allocator.h"
+
+const uint8_t ZoneAllocator::NO_ZONE;
+const uint8_t ZoneAllocator::MAX_ZONES_COUNT;
+
+ZoneAllocator::ZoneAllocator(NameTable* names)
+{
+	this->names = names;
+}
+
+ZoneAllocator::~ZoneAllocator()
+{
+	foreach (Zone* zone, zones)
+	{
+		delete zone->mem;
+		delete zone;
+	}
+}
+
+QResultStatus ZoneAllocator::addZone(const uint8_t totalDegree, const uint8_t minDegree)
+{
+	if (zones.size() >= MAX_ZONES_COUNT || minDegree > totalDegree)
+	{
+		return QResult_DataOutOfRange;
+	}
+
+	Zone* zone = new Zone();
+	if (zone->settings.setTotalMemoryDegree(totalDegree) != QResult_Success ||
+			zone->settings.setMinBlockDegree(minDegree) != QResult_Success)
+	{
+		delete zone;
+		return QResult_DataOutOfRange;
+	}
+	zone->mem = new Memory(&zone->settings, names);
+	zone->allocationsCount = 0;
+	zone->fallbacksCount = 0;
+	zone->failuresCount = 0;
+	zones.push_back(zone);
+
+	// by default the nearest zones are tried first, as with the distances between NUMA nodes
+	for (uint8_t zoneIndex = 0; zoneIndex < zones.size(); ++zoneIndex)
+	{
+		QVector<uint8_t>& order = zones[zoneIndex]->fallbackOrder;
+		order.clear();
+		for (uint8_t distance = 1; distance < zones.size(); ++distance)
+		{
+			if (zoneIndex >= distance) order.push_back(zoneIndex - distance);
+			if (zoneIndex + distance < zones.size()) order.push_back(zoneIndex + distance);
+		}
+	}
+	return QResult_Success;
+}
+
+QResultStatus ZoneAllocator::setFallbackOrder(const uint8_t zone, const QVector<uint8_t>& order)
+{
+	if (zone >= zones.size())
+	{
+		return QResult_IndexOutOfRange;
+	}
+
+	QVector<bool> isListed(zones.size(), false);
+	foreach (uint8_t zoneIndex, order)
+	{
+		if (zoneIndex >= zones.size() || zoneIndex == zone || isListed.at(zoneIndex))
+		{
+			return QResult_IncorrectData;
+		}
+		isListed[zoneIndex] = true;
+	}
+
+	QMutexLocker locker(&zones.at(zone)->mutex);
+	zones.at(zone)->fallbackOrder = order;
+	return QResult_Success;
+}
+
+QResultStatus ZoneAllocator::allocate(const uint64_t bytes, const uint32_t procId, const uint8_t preferredZone)
+{
+	if (preferredZone >= zones.size())
+	{
+		return QResult_IndexOutOfRange;
+	}
+	if (procId == NameTable::NO_NAME)
+	{
+		return QResult_IncorrectData;
+	}
+	{
+		// names are unique across zones, the name is reserved until a zone takes it
+		QMutexLocker locker(&ownersMutex);
+		if (owners.contains(procId))
+		{
+			return QResult_ActionUnavailable;
+		}
+		owners.insert(procId, NO_ZONE);
+	}
+
+	// only one zone is locked at a time, so threads of different zones never wait for each other in a cycle
+	Zone* preferred = zones.at(preferredZone);
+	QVector<uint8_t> order;
+	{
+		QMutexLocker locker(&preferred->mutex);
+		order = preferred->fallbackOrder;
+	}
+	order.prepend(preferredZone);
+
+	uint8_t takingZone = NO_ZONE;
+	foreach (uint8_t zoneIndex, order)
+	{
+		Zone* zone = zones.at(zoneIndex);
+		QMutexLocker locker(&zone->mutex);
+		if (zone->mem->allocate(bytes, procId) == QResult_Success)
+		{
+			takingZone = zoneIndex;
+			++zone->allocationsCount;
+			if (zoneIndex != preferredZone) ++zone->fallbacksCount;
+			break;
+		}
+	}
+
+	if (takingZone == NO_ZONE)
+	{
+		{
+			QMutexLocker locker(&preferred->mutex);
+			++preferred->failuresCount;
+		}
+		QMutexLocker locker(&ownersMutex);
+		owners.remove(procId);
+		return QResult_ActionUnavailable;
+	}
+
+	QMutexLocker locker(&ownersMutex);
+	owners.insert(procId, takingZone);
+	return QResult_Success;
+}
+
+QResultStatus ZoneAllocator::free(const uint32_t procId)
+{
+	uint8_t zoneIndex = NO_ZONE;
+	{
+		QMutexLocker locker(&ownersMutex);
+		zoneIndex = owners.value(procId, NO_ZONE);
+		if (zoneIndex == NO_ZONE)
+		{
+			return QResult_Failure;
+		}
+		// the name stays reserved until the zone has freed the block, so it cannot be taken again before
+		owners.insert(procId, NO_ZONE);
+	}
+
+	QResultStatus resultStatus = QResult_Success;
+	{
+		Zone* zone = zones.at(zoneIndex);
+		QMutexLocker locker(&zone->mutex);
+		resultStatus = zone->mem->free(procId);
+	}
+
+	QMutexLocker locker(&ownersMutex);
+	if (resultStatus == QResult_Success) owners.remove(procId);
+	else owners.insert(procId, zoneIndex);
+	return resultStatus;
+}
+
+uint8_t ZoneAllocator::findZone(const uint32_t procId)
+{
+	QMutexLocker locker(&ownersMutex);
+	return owners.value(procId, NO_ZONE);
+}
+
+uint8_t ZoneAllocator::getZonesCount() const
+{
+	return zones.size();
+}
+
+QVector<uint8_t> ZoneAllocator::getFallbackOrder(const uint8_t zone) const
+{
+	if (zone >= zones.size())
+	{
+		return QVector<uint8_t>();
+	}
+	QMutexLocker locker(&zones.at(zone)->mutex);
+	return zones.at(zone)->fallbackOrder;
+}
+
+ZoneStats ZoneAllocator::getStats(const uint8_t zone)
+{
+	ZoneStats stats = ZoneStats();
+	if (zone >= zones.size())
+	{
+		return stats;
+	}
+
+	Zone* selected = zones.at(zone);
+	QMutexLocker locker(&selected->mutex);
+	stats.totalDegree = selected->mem->getTotalDegree();
+	stats.grantedBytes = selected->mem->getGrantedBytes();
+	stats.requestedBytes = selected->mem->getRequestedBytes();
+	stats.freeBytes = selected->mem->getFreeBytes();
+	stats.allocationsCount = selected->allocationsCount;
+	stats.fallbacksCount = selected->fallbacksCount;
+	stats.failuresCount = selected->failuresCount;
+	return stats;
+}
+
+Memory* ZoneAllocator::getMemory(const uint8_t zone) const
+{
+	return zone < zones.size() ? zones.at(zone)->mem : nullptr;
+}
@@ -0,0 +1,73 @@
+#ifndef ZONE_ALLOCATOR_H
+#define ZONE_ALLOCATOR_H
+
+#include <QtCore/qglobal.h>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+
+#include "common.h"
+#include "memory.h"
+#include "memory_settings.h"
+#include "name_table.h"
+
+/// Utilization and traffic of one zone.
+struct ZoneStats
+{
+	uint8_t totalDegree;
+	uint64_t grantedBytes;
+	uint64_t requestedBytes;
+	uint64_t freeBytes;
+	/// Allocations taken by the zone, including the ones which preferred another zone.
+	uint64_t allocationsCount;
+	/// Allocations taken by the zone after the preferred zone had no fitting block.
+	uint64_t fallbacksCount;
+	/// Allocations which preferred the zone and were not taken by any zone.
+	uint64_t failuresCount;
+};
+
+/// Several independent buddy trees, such as memory of NUMA nodes, behind one allocator.
+/// An allocation tries its preferred zone and then the fallback order of that zone.
+/// Every zone has its own lock, so each zone can be driven by a separate thread.
+class ZoneAllocator
+{
+	public:
+		static const uint8_t NO_ZONE = UINT8_MAX;
+		static const uint8_t MAX_ZONES_COUNT = 64;
+
+		explicit ZoneAllocator(NameTable* names);
+		~ZoneAllocator();
+
+		/// Zones are added before the allocator is shared, every added zone resets fallback orders to nearest first.
+		QResultStatus addZone(const uint8_t totalDegree, const uint8_t minDegree);
+		QResultStatus setFallbackOrder(const uint8_t zone, const QVector<uint8_t>& order);
+		QResultStatus allocate(const uint64_t bytes, const uint32_t procId, const uint8_t preferredZone);
+		QResultStatus free(const uint32_t procId);
+		uint8_t findZone(const uint32_t procId);
+		uint8_t getZonesCount() const;
+		QVector<uint8_t> getFallbackOrder(const uint8_t zone) const;
+		ZoneStats getStats(const uint8_t zone);
+		/// Memory of the zone, which is safe to use only while no other thread drives the zone.
+		Memory* getMemory(const uint8_t zone) const;
+
+	private:
+		struct Zone
+		{
+			MemorySettings settings;
+			Memory* mem;
+			QMutex mutex;
+			/// Zones tried after this one, the nearest first.
+			QVector<uint8_t> fallbackOrder;
+			uint64_t allocationsCount;
+			uint64_t fallbacksCount;
+			uint64_t failuresCount;
+		};
+
+		NameTable* names;
+		QVector<Zone*> zones;
+		/// Zone of every allocated process, NO_ZONE while the allocation is in progress.
+		QHash<uint32_t, uint8_t> owners;
+		QMutex ownersMutex;
+};
+
+#endif // ZONE_ALLOCATOR_H